@@ -1,27 +1,93 @@
 #include "hotel.h"
 
-int main() {
+int main(int argc, char *argv[]) {
     // Initialize variables and structures
-    srand(time(NULL)); // Seed the random number generator
-    User users[MAX_USERS];
-    Room rooms[MAX_ROOMS];
-    Booking *bookingHead = NULL;
-    LoginLogoutEvent events[MAX_EVENTS];
-    int userCount = 0;
-    int roomCount = 0;
-    int bookingCount = 0;
-    int eventCount = 0;
+    UserStore users = {0};
+    RoomStore rooms = {0};
+    BookingStore bookings = {0};
+    EventStore events = {0};
     int choice = 0;
 
-    // Load data from files
-    loadUsers(users, &userCount); // Load users from file to the array
-    loadRooms(rooms, &roomCount); // Load rooms from file to the array
-    bookingHead = loadBookings(&bookingCount); // Load existing bookings
-    loadEvents(events, &eventCount); // Load events from file
-    addAdministratorInfoToFile(users, &userCount); // Ensure admin info is present
-    autoCancelReservations(&bookingHead); // Auto cancel reservations which have check in date are late
+    // "./Hotel --daemon" serves the bookings to the other terminals instead of showing the menus,
+    // and "--durability none|async|fsync" chooses how hard every save works to reach the disk
+    bool daemonMode = false;
+    DurabilityMode durability = DURABILITY_NONE;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--daemon") == 0) {
+            daemonMode = true;
+        } else if (strcmp(argv[i], "--durability") == 0 && i + 1 < argc && parseDurabilityMode(argv[i + 1], &durability)) {
+            i++;
+        } else {
+            printf("Usage: %s [--daemon] [--durability none|async|fsync]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    // While a daemon runs it owns the bookings, and this terminal sends it every booking operation
+    bool remote = isDaemonRunning();
+    if (daemonMode && remote) {
+        printf("Error: A hotel daemon is already running in this directory.\n");
+        return 1;
+    }
+
+    // The daemon locks the directory exclusively and a terminal working on its own copy shares the lock,
+    // so neither can start while the other runs; terminals of the daemon only announce themselves
+    DirectoryLock lock;
+    if (daemonMode) {
+        if (!lockHotelDirectory(&lock, true)) {
+            printf("Error: Other terminals are still running in this directory. Close them before starting the daemon.\n");
+            return 1;
+        }
+    } else if (!remote) {
+        if (!lockHotelDirectory(&lock, false)) {
+            printf("Error: A hotel daemon is starting or a terminal is saving in this directory. Try again in a moment.\n");
+            return 1;
+        }
+    }
+    if (remote) {
+        announceTerminal(&lock);
+        signal(SIGPIPE, SIG_IGN); // Report a daemon that goes away instead of being killed by it
+    }
+
+    // Every store saves through the same persistence layer
+    Persistence disk;
+    startPersistence(&disk, durability);
+
+    // Load data from the binary snapshot, or from the text files when they changed since it was written
+    // The stores are connected to the disk afterwards, since a snapshot that cannot be used leaves them cleared
+    DataFileStamps loaded;
+    SnapshotMapping mapping;
+    bool fromSnapshot = loadSnapshot(&users, &rooms, &bookings, &events, &loaded, &mapping);
+    users.disk = rooms.disk = bookings.disk = &disk;
+    events.writer.disk = &disk;
+    if (!fromSnapshot) {
+        stampLoadedFiles(&loaded); // Before reading any file, so a change made while loading is noticed
+        loadUsers(&users); // Load users from file to the array
+        loadRooms(&rooms); // Load rooms from file to the array
+        if (!remote) {
+            loadBookings(&bookings); // Load existing bookings
+        }
+        loadEvents(&events); // Load events from file
+    }
+    addAdministratorInfoToFile(&users); // Ensure admin info is present
+    if (!remote) {
+        autoCancelReservations(&bookings); // Auto cancel reservations which have check in date are late
+        if (!fromSnapshot) {
+            saveSnapshot(&users, &rooms, &bookings, &events, &loaded); // Skip the text parsing next time
+        }
+    }
+
+    if (daemonMode) {
+        runDaemon(&bookings);
+        choice = 4; // Skip the menus
+    } else {
+        startEventWriter(&events.writer, &disk); // Log logins and logouts without waiting for the disk
+    }
 
     while (choice != 4) {
+        if (!remote) {
+            autoCancelReservations(&bookings); // Cancel reservations that became overdue while the program was running
+        }
         displayMainMenu();
         printf("Enter your choice (1-4): ");
         scanf("%d", &choice);
@@ -29,13 +95,13 @@ int main() {
 
         switch (choice) {
             case 1:
-                loginUser(users, &userCount, rooms, &roomCount, &bookingHead, &bookingCount, events, &eventCount);
+                loginUser(&users, &rooms, &bookings, &events, remote);
                 break;
             case 2:
-                checkRoomAvailabilities(&bookingHead, rooms, &roomCount);
+                checkRoomAvailabilities(&bookings, &rooms, remote);
                 break;
             case 3:
-                searchRooms(rooms, &roomCount);
+                searchRooms(&rooms);
                 break;
             case 4:
                 printf("Exiting... Thank you!\n");
@@ -45,9 +111,47 @@ int main() {
         }
     }
 
-    // Free allocated memory for bookings
-    freeBookings(bookingHead);
+    // Write out any events still waiting in the queue, then every change the committer still holds
+    stopEventWriter(&events.writer);
+    stopPersistence(&disk);
+
+    // A terminal that ran alone holds every change made to the files since it loaded them, so it writes
+    // the snapshot from its stores, stamped with the files as they are now. Otherwise the snapshot is only
+    // written if the text files are still as they were loaded.
+    // The daemon and its terminals skip it: each of them holds only part of the data current, so the
+    // snapshot is left to the next terminal that runs on its own
+    if (!remote && !daemonMode) {
+        if (ranAlone(&lock)) {
+            DataFileStamps current;
+            stampLoadedFiles(&current);
+            saveSnapshot(&users, &rooms, &bookings, &events, &current);
+        } else {
+            saveSnapshot(&users, &rooms, &bookings, &events, &loaded);
+        }
+    }
+
+    // Free allocated memory for all stores
+    freeBookings(&bookings);
+    if (!users.itemsMapped) {
+        free(users.items);
+    }
+    free(users.idIndex.slots);
+    free(users.freeSlots);
+    if (!rooms.itemsMapped) {
+        free(rooms.items);
+    }
+    free(rooms.idIndex.slots);
+    free(rooms.freeSlots);
+    freeRoomCatalog(&rooms.catalog);
+    freeStringPool(&rooms.amenityNames);
+    freeEvents(&events);
+    if (mapping.base != NULL) {
+        munmap(mapping.base, mapping.size); // Only after the stores that point into it are freed
+    }
 
+    if (lock.fd != -1) {
+        close(lock.fd); // Releases the directory lock
+    }
     return 0;
 }
 
@@ -117,13 +221,265 @@ void clearInputBuffer() {
 void getCurrentDate(char* buffer, int bufferSize) {
     // Get the current time
     time_t t = time(NULL);
-    // Convert to local time
-    struct tm tm = *localtime(&t);
+    // Convert to local time (localtime_r, since daemon workers call this at the same time)
+    struct tm tm;
+    localtime_r(&t, &tm);
     // Format the date as a string and store it in the buffer
     snprintf(buffer, bufferSize, "%04d-%02d-%02d", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday);
 }
 
 
+// Function to convert a YYYY-MM-DD date to a day number (days since 1970-01-01)
+int dateToDayNumber(const char *date) {
+    // Digits are at fixed positions, so read them directly rather than through sscanf
+    int year = (date[0] - '0') * 1000 + (date[1] - '0') * 100 + (date[2] - '0') * 10 + (date[3] - '0');
+    int month = (date[5] - '0') * 10 + (date[6] - '0');
+    int day = (date[8] - '0') * 10 + (date[9] - '0');
+
+    // Count years from March so that the leap day is the last day of the year
+    year -= month <= 2;
+    int era = (year >= 0 ? year : year - 399) / 400;
+    int yearOfEra = year - era * 400;
+    int dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+
+// Function to convert a day number (days since 1970-01-01) back to a YYYY-MM-DD date
+void dayNumberToDate(int dayNumber, char *buffer, int bufferSize) {
+    // Inverse of dateToDayNumber, again counting years from March
+    dayNumber += 719468;
+    int era = (dayNumber >= 0 ? dayNumber : dayNumber - 146096) / 146097;
+    int dayOfEra = dayNumber - era * 146097;
+    int yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    int dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    int monthIndex = (5 * dayOfYear + 2) / 153;
+    int day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+    int month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+    int year = yearOfEra + era * 400 + (month <= 2);
+    snprintf(buffer, bufferSize, "%04d-%02d-%02d", year, month, day);
+}
+
+
+// Function to hash a string (FNV-1a)
+unsigned int hashString(const char *str) {
+    unsigned int hash = 2166136261u;
+    while (*str) {
+        hash ^= (unsigned char)*str++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+
+// Function to put an entry into the first empty slot of its probe run
+void placeSlotEntry(int *slots, int capacity, int entry, unsigned int hash) {
+    unsigned int mask = capacity - 1;
+    unsigned int slot = hash & mask;
+    while (slots[slot] != -1) {
+        slot = (slot + 1) & mask;
+    }
+    slots[slot] = entry;
+}
+
+
+// Function to size a slot index for an expected number of entries, rehashing the entries it already holds
+// Returns false, leaving the index as it was, if the larger table could not be allocated
+bool reserveSlotIndex(SlotIndex *index, int expected, SlotHash hash, const void *owner) {
+    // Keep the table at most half full so probe sequences stay short
+    int capacity = 64;
+    while (capacity < expected * 2) {
+        capacity *= 2;
+    }
+    if (capacity <= index->capacity) {
+        return true; // Already large enough
+    }
+
+    int *slots = malloc(capacity * sizeof(int));
+    if (slots == NULL) {
+        perror("Failed to allocate memory for hash index");
+        return false;
+    }
+    memset(slots, -1, capacity * sizeof(int)); // Every slot starts empty
+
+    // Re-insert the entries starting after an empty slot, so every probe run is walked from its start
+    // and entries with the same key stay in the order they were added
+    if (index->count > 0) {
+        unsigned int mask = index->capacity - 1;
+        unsigned int start = 0;
+        while (index->slots[start] != -1) {
+            start++;
+        }
+        for (unsigned int i = 1; i <= mask + 1; i++) {
+            int entry = index->slots[(start + i) & mask];
+            if (entry != -1) {
+                placeSlotEntry(slots, capacity, entry, hash(owner, entry));
+            }
+        }
+    }
+    if (!index->mapped) {
+        free(index->slots);
+    }
+    index->slots = slots;
+    index->capacity = capacity;
+    index->mapped = false;
+    return true;
+}
+
+
+// Function to add an entry to a slot index, growing the table when it would become more than half full
+bool addSlotEntry(SlotIndex *index, int entry, SlotHash hash, const void *owner) {
+    if ((index->count + 1) * 2 > index->capacity && !reserveSlotIndex(index, index->count + 1, hash, owner)) {
+        return false;
+    }
+    placeSlotEntry(index->slots, index->capacity, entry, hash(owner, entry));
+    index->count++;
+    return true;
+}
+
+
+// Function to remove an entry from a slot index
+// Later entries of the same probe run are moved back into the gap so that lookups never stop early
+void removeSlotEntry(SlotIndex *index, int entry, SlotHash hash, const void *owner) {
+    if (index->count == 0) {
+        return;
+    }
+
+    // Find the slot holding the entry
+    unsigned int mask = index->capacity - 1;
+    unsigned int gap = hash(owner, entry) & mask;
+    while (index->slots[gap] != entry) {
+        if (index->slots[gap] == -1) {
+            return; // Not indexed
+        }
+        gap = (gap + 1) & mask;
+    }
+
+    for (unsigned int next = (gap + 1) & mask; index->slots[next] != -1; next = (next + 1) & mask) {
+        // An entry can fill the gap unless its home slot lies between the gap and where it sits now
+        unsigned int home = hash(owner, index->slots[next]) & mask;
+        if (((next - home) & mask) >= ((next - gap) & mask)) {
+            index->slots[gap] = index->slots[next];
+            gap = next;
+        }
+    }
+    index->slots[gap] = -1;
+    index->count--;
+}
+
+
+// Function to find the first entry added with a key, or -1 if there is none
+// keyHash must be the hash that entries with the key are stored under
+int findSlotEntry(const SlotIndex *index, unsigned int keyHash, SlotMatch matches, const void *owner, const void *key) {
+    if (index->count == 0) {
+        return -1;
+    }
+
+    // Probe from the hashed slot until the entry or an empty slot is found
+    unsigned int mask = index->capacity - 1;
+    for (unsigned int slot = keyHash & mask; index->slots[slot] != -1; slot = (slot + 1) & mask) {
+        if (matches(owner, index->slots[slot], key)) {
+            return index->slots[slot];
+        }
+    }
+    return -1;
+}
+
+
+// Function to remove every entry from a slot index, keeping its table
+void clearSlotIndex(SlotIndex *index) {
+    if (index->capacity > 0) {
+        memset(index->slots, -1, index->capacity * sizeof(int));
+    }
+    index->count = 0;
+}
+
+
+// Function to hash the string behind a handle of a string pool
+unsigned int hashInternedEntry(const void *pool, int handle) {
+    return hashString(((const StringPool*)pool)->strings[handle]);
+}
+
+
+// Function to check whether the string behind a handle of a string pool is a given string
+bool matchInternedEntry(const void *pool, int handle, const void *str) {
+    return strcmp(((const StringPool*)pool)->strings[handle], str) == 0;
+}
+
+
+// Function to find the handle of an interned string, returning -1 if it was never interned
+int findInternedString(StringPool *pool, const char *str) {
+    return findSlotEntry(&pool->index, hashString(str), matchInternedEntry, pool, str);
+}
+
+
+// Function to intern a string, returning the handle shared by every copy of it
+int internString(StringPool *pool, const char *str) {
+    int handle = findInternedString(pool, str);
+    if (handle != -1) {
+        return handle; // Already interned
+    }
+
+    // Grow the string array if needed
+    if (pool->count == pool->capacity) {
+        int newCapacity = pool->capacity == 0 ? 64 : pool->capacity * 2;
+        char **grown = realloc(pool->strings, newCapacity * sizeof(char*));
+        if (grown == NULL) {
+            perror("Failed to allocate memory for string pool");
+            return -1;
+        }
+        pool->strings = grown;
+        pool->capacity = newCapacity;
+    }
+
+    char *copy = strdup(str);
+    if (copy == NULL) {
+        perror("Failed to allocate memory for string pool");
+        return -1;
+    }
+
+    handle = pool->count;
+    pool->strings[handle] = copy;
+    if (!addSlotEntry(&pool->index, handle, hashInternedEntry, pool)) {
+        free(copy);
+        return -1;
+    }
+    pool->count++;
+    return handle;
+}
+
+
+// Function to get the interned string behind a handle
+const char* internedString(StringPool *pool, int handle) {
+    return pool->strings[handle];
+}
+
+
+// Function to free memory allocated for a string pool
+void freeStringPool(StringPool *pool) {
+    for (int i = 0; i < pool->count; i++) {
+        free(pool->strings[i]);
+    }
+    free(pool->strings);
+    free(pool->index.slots);
+    memset(pool, 0, sizeof(StringPool));
+}
+
+
+// Function to check that a string is a date in the format YYYY-MM-DD
+bool isValidDate(const char *date) {
+    for (int i = 0; i < DATE_LENGTH - 1; i++) {
+        if (i == 4 || i == 7 ? date[i] != '-' : (date[i] < '0' || date[i] > '9')) {
+            return false;
+        }
+    }
+    int month = (date[5] - '0') * 10 + (date[6] - '0');
+    int day = (date[8] - '0') * 10 + (date[9] - '0');
+    return date[DATE_LENGTH - 1] == '\0' && month >= 1 && month <= 12 && day >= 1 && day <= 31;
+}
+
+
 // Function to validate and get date in the format YYYY-MM-DD
 void getValidDate(char* date, const char* prompt, int allowPastDate, const char* referenceDate) {
     regex_t regex;
@@ -163,191 +519,705 @@ void getValidDate(char* date, const char* prompt, int allowPastDate, const char*
 
 
 // Function to get the current timestamp in "YYYY-MM-DD HH:MM:SS" format
-void getCurrentTimestamp(char *buffer, int bufferSize) {
+long long getCurrentTimestamp() {
     time_t now = time(NULL);
     struct tm *t = localtime(&now);
-    strftime(buffer, bufferSize, "%Y-%m-%d %H:%M:%S", t);
+    char date[DATE_LENGTH];
+    strftime(date, DATE_LENGTH, "%Y-%m-%d", t);
+    return (long long)dateToDayNumber(date) * 86400 + t->tm_hour * 3600 + t->tm_min * 60 + t->tm_sec;
 }
-// USER FUNCTIONS
 
-// Function to save users to file
-void saveUsers(User users[], int userCount) {
-    // Open the users file in write mode
-    FILE *file = fopen(USERS_FILE, "w");
-    // Check if the file was successfully opened
-    if (file == NULL) {
-        printf("Error: Unable to open users file for writing.\n");
-        return;
+
+// Function to convert a YYYY-MM-DD HH:MM:SS timestamp to seconds since 1970-01-01 00:00:00
+// The clock is local time with no time zone applied, so values sort like the text and round-trip exactly
+// Returns -1 if the text is not a valid timestamp
+long long parseTimestamp(const char *text) {
+    char date[DATE_LENGTH];
+    if (strlen(text) != DATE_TIME_TEXT_LENGTH || text[10] != ' ' || text[13] != ':' || text[16] != ':') {
+        return -1;
     }
+    memcpy(date, text, DATE_LENGTH - 1);
+    date[DATE_LENGTH - 1] = '\0';
 
-    // Write user data to the file
-    for (int i = 0; i < userCount; i++) {
-        fprintf(file, "%d, %s, %s, %s, %s, %d\n", users[i].orderNum, users[i].name, users[i].id, users[i].password, users[i].role, users[i].active);
+    int fields[3];
+    for (int i = 0; i < 3; i++) {
+        const char *digits = text + 11 + i * 3;
+        if (!isdigit((unsigned char)digits[0]) || !isdigit((unsigned char)digits[1])) {
+            return -1;
+        }
+        fields[i] = (digits[0] - '0') * 10 + (digits[1] - '0');
     }
+    if (!isValidDate(date) || fields[0] > 23 || fields[1] > 59 || fields[2] > 60) {
+        return -1;
+    }
+    return (long long)dateToDayNumber(date) * 86400 + fields[0] * 3600 + fields[1] * 60 + fields[2];
+}
 
-    // Close the file
-    fclose(file);
+
+// Function to format seconds since 1970-01-01 00:00:00 as YYYY-MM-DD HH:MM:SS
+void formatTimestamp(long long timestamp, char *buffer, int bufferSize) {
+    // Floor division keeps the time of day positive for timestamps before 1970
+    long long day = timestamp >= 0 ? timestamp / 86400 : -((-timestamp + 86399) / 86400);
+    int seconds = (int)(timestamp - day * 86400);
+
+    char date[DATE_LENGTH];
+    dayNumberToDate((int)day, date, DATE_LENGTH);
+    snprintf(buffer, bufferSize, "%s %02d:%02d:%02d", date, seconds / 3600, seconds / 60 % 60, seconds % 60);
 }
 
 
-// Function to load users from file
-int loadUsers(User users[], int *userCount) {
-    // Open the users file in read mode
-    FILE *file = fopen(USERS_FILE, "r");
-    // Check if the file was successfully opened
-    if (file == NULL) {
-        printf("Error: Unable to open users file for reading.\n");
-        *userCount = 0;
-        return 0; // No users file found, start with empty user list
+// Function to read a whole data file into memory for record parsing
+// The file is read with one bulk read and later tokenized in place, so fields are never copied while parsing
+bool openRecordReader(RecordReader *reader, const char *path) {
+    memset(reader, 0, sizeof(RecordReader));
+    reader->path = path;
+
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        return false;
     }
 
-    *userCount = 0; // Initialize user count
-    // Read user data from the file
-    while (fscanf(file, "%d, %25[^,], %25[^,], %25[^,], %25[^,], %d\n", &users[*userCount].orderNum, users[*userCount].name, users[*userCount].id, users[*userCount].password, users[*userCount].role, &users[*userCount].active) == 6) {
-        (*userCount)++; // Increment user count
+    struct stat info;
+    if (fstat(fd, &info) == -1) {
+        close(fd);
+        return false;
     }
 
-    // Close the file
-    fclose(file);
-    return 1; // Users loaded successfully
+    // One extra byte keeps the buffer NUL-terminated even when the last line has no newline
+    reader->data = malloc(info.st_size + 1);
+    if (reader->data == NULL) {
+        perror("Failed to allocate memory for data file");
+        close(fd);
+        return false;
+    }
+
+    size_t total = 0;
+    while (total < (size_t)info.st_size) {
+        ssize_t got = read(fd, reader->data + total, info.st_size - total);
+        if (got <= 0) {
+            break; // The file shrank or could not be read, parse what arrived
+        }
+        total += got;
+    }
+    close(fd);
+
+    reader->data[total] = '\0';
+    reader->size = total;
+    reader->cursor = reader->data;
+    return true;
 }
 
 
-// Function to add administrator information to the file
-void addAdministratorInfoToFile(User users[], int *userCount) {
-    
-    // Check if administrator information already exists
-    for (int i = 0; i < *userCount; i++) {
-        if (strcmp(users[i].id, "admin") == 0 && strcmp(users[i].password, "admin") == 0 && strcmp(users[i].role, "Administrator") == 0 && users[i].active == 1) {
-            return;
+// Function to write a whole buffer to a file or socket
+bool writeAll(int fd, const char *data, size_t size) {
+    while (size > 0) {
+        ssize_t written = write(fd, data, size);
+        if (written <= 0) {
+            return false;
         }
+        data += written;
+        size -= written;
     }
+    return true;
+}
 
-    // Add administrator information to the users array
-    users[*userCount].orderNum = 1; // Set the order number for the administrator
-    strcpy(users[*userCount].name, "Administrator"); // Set the name for the administrator
-    strcpy(users[*userCount].id, "admin"); // Set the ID for the administrator
-    strcpy(users[*userCount].password, "admin"); // Set the password for the administrator
-    strcpy(users[*userCount].role, "Administrator"); // Set the role for the administrator
-    users[*userCount].active = 1; // Set the status as active for the administrator
-    (*userCount)++; // Increment the user count
 
-    // Save the updated users array to file
-    saveUsers(users, *userCount);
+// Function to parse records from text already in memory, such as a daemon request or reply
+// data must be malloc'd and NUL-terminated at data[size]; the reader takes it over and closeRecordReader frees it
+void openRecordBuffer(RecordReader *reader, const char *path, char *data, size_t size) {
+    memset(reader, 0, sizeof(RecordReader));
+    reader->path = path;
+    reader->data = data;
+    reader->size = size;
+    reader->cursor = data;
 }
 
 
-// Function to prompt for user name and validate, returning a dynamically allocated string
-char* promptValidName() {
-    char input_name[NAME_LENGTH];
-    bool validInput = false;
-    while (!validInput) {
-        printf("\nEnter name: ");
-        fgets(input_name, NAME_LENGTH, stdin);
-        input_name[strcspn(input_name, "\n")] = '\0'; // Remove newline character
+// Function to split the next non-empty line of a data file into comma-separated fields
+// Fields point into the reader's buffer with the ", " separators replaced by terminators
+// Returns the number of fields found (at most maxFields + 1 so extra fields are detectable), or -1 at end of file
+int nextRecord(RecordReader *reader, char **fields, int maxFields) {
+    char *line;
+    char *end;
 
-        // Check if name exceeds the maximum length
-        if (strlen(input_name) > (int)(NAME_LENGTH - 2)) {
-            printf("Name is too long. Please enter a name with at most %d characters.\n", NAME_LENGTH - 2);
-            clearInputBuffer(); // Clear any extra characters from the input buffer
+    // Skip blank lines
+    do {
+        if (*reader->cursor == '\0') {
+            return -1;
         }
-        // Check if name contains any numeric characters
-        else if (containNumeric(input_name)) {
-            printf("Name should not contain numeric characters. Please try again.\n");
+        line = reader->cursor;
+        end = memchr(line, '\n', reader->size - (line - reader->data));
+        if (end == NULL) {
+            end = reader->data + reader->size;
+            reader->cursor = end;
+        } else {
+            *end = '\0';
+            reader->cursor = end + 1;
         }
-        // Check if name contains any comma characters
-        else if (containComma(input_name)) {
-            printf("Name should not contain comma characters. Please try again.\n");
+        reader->lineNumber++;
+
+        // Trim trailing whitespace (including the CR of CRLF files)
+        while (end > line && isspace((unsigned char)end[-1])) {
+            *--end = '\0';
         }
-        // Check if name is empty
-        else if (isEmpty(input_name)) {
-            printf("Name cannot be empty. Please try again.\n");
+    } while (end == line);
+
+    // Split on commas, dropping the space that follows each one
+    int count = 0;
+    char *field = line;
+    while (count <= maxFields) {
+        while (*field == ' ') {
+            field++;
         }
-        else {
-            validInput = true;
+        fields[count++] = field;
+        char *comma = memchr(field, ',', end - field);
+        if (comma == NULL) {
+            break;
         }
+        *comma = '\0';
+        field = comma + 1;
     }
-    return strdup(input_name); // Dynamically allocate memory and copy the name
+    return count;
 }
 
 
-// Function to prompt for user ID and validate, returning a dynamically allocated string
-char* promptValidID(User users[], int userCount) {
-    char input_id[ID_LENGTH];
-    bool validInput = false;
-    while (!validInput) {
-        printf("\nEnter ID: ");
-        fgets(input_id, ID_LENGTH, stdin);
-        input_id[strcspn(input_id, "\n")] = '\0'; // Remove newline character
+// Function to report a line of a data file that could not be parsed
+void reportMalformedRecord(RecordReader *reader, const char *reason) {
+    printf("Warning: Skipping malformed line %d in %s (%s).\n", reader->lineNumber, reader->path, reason);
+}
 
-        // Check if username exceeds the maximum length
-        if (strlen(input_id) > (int)(ID_LENGTH - 2)) {
-            printf("ID is too long. Please enter an ID with at most %d characters.\n", ID_LENGTH - 2);
-            clearInputBuffer(); // Clear any extra characters from the input buffer
-        }
-        // Check if ID contains spaces
-        else if (containSpaces(input_id)) {
-            printf("ID should not contain spaces. Please try again.\n");
-        }
-        // Check if name contains any comma characters
-        else if (containComma(input_id)) {
-            printf("Name should not contain comma characters. Please try again.\n");
-        }
-        // Check if ID is empty
-        else if (isEmpty(input_id)) {
-            printf("ID cannot be empty. Please try again.\n");
-        }
-        else {
-            // Check if ID is already in use
-            bool idExists = false;
-            for (int i = 0; i < userCount; i++) {
-                if (strcmp(users[i].id, input_id) == 0) {
-                    idExists = true;
-                    break;
-                }
-            }
-            if (idExists) {
-                printf("ID is already in use. Please try again.\n");
-            } else {
-                validInput = true; // ID is valid, break out of the loop
-            }
-        }
+
+// Function to release the buffer of a data file
+void closeRecordReader(RecordReader *reader) {
+    free(reader->data);
+    reader->data = NULL;
+}
+
+
+// Function to parse an integer field, returning false if it is not a whole number
+bool parseIntField(const char *field, int *value) {
+    char *end;
+    long parsed = strtol(field, &end, 10);
+    if (end == field || *end != '\0') {
+        return false;
     }
-    return strdup(input_id); // Dynamically allocate memory and copy the ID
+    *value = (int)parsed;
+    return true;
 }
 
 
-// Function to prompt for user password and validate, returning a dynamically allocated string
-char* promptValidPassword() {
-    char input_password[PASSWORD_LENGTH];
-    bool validInput = false;
-    while (!validInput) {
-        printf("\nEnter password: ");
-        fgets(input_password, PASSWORD_LENGTH, stdin);
-        input_password[strcspn(input_password, "\n")] = '\0'; // Remove newline character
+// Function to parse a 64-bit integer field, returning false if it is not a whole number
+bool parseLongLongField(const char *field, long long *value) {
+    char *end;
+    long long parsed = strtoll(field, &end, 10);
+    if (end == field || *end != '\0') {
+        return false;
+    }
+    *value = parsed;
+    return true;
+}
 
-        // Check if password exceeds the maximum length
-        if (strlen(input_password) > (int)(PASSWORD_LENGTH - 2)) {
-            printf("Password is too long. Please enter a password with at most %d characters.\n", PASSWORD_LENGTH - 2);
-            clearInputBuffer(); // Clear any extra characters from the input buffer
-        }
-        // Check if password is empty
-        else if (isEmpty(input_password)) {
-            printf("Password cannot be empty. Please try again.\n");
+
+// Function to parse a decimal field, returning false if it is not a number
+bool parseFloatField(const char *field, float *value) {
+    char *end;
+    float parsed = strtof(field, &end);
+    if (end == field || *end != '\0') {
+        return false;
+    }
+    *value = parsed;
+    return true;
+}
+
+
+// Function to parse a YYYY-MM-DD field into a day number, returning false if it is not a valid date
+bool parseDateField(const char *field, int *day) {
+    if (!isValidDate(field)) {
+        return false;
+    }
+    *day = dateToDayNumber(field);
+    return true;
+}
+
+
+// Function to copy a text field into a fixed-size buffer, returning false if it does not fit
+bool copyField(char *dest, const char *field, size_t size) {
+    size_t length = strlen(field);
+    if (length >= size) {
+        return false;
+    }
+    memcpy(dest, field, length + 1);
+    return true;
+}
+
+
+// Function to append a handle to the list kept for a key, growing the table of lists to cover the key
+// Returns false for a negative key (a string that could not be interned) or if the lists could not grow
+bool appendToHandleList(HandleList **lists, int *listCapacity, int key, int handle) {
+    if (key < 0) {
+        return false;
+    }
+    if (key >= *listCapacity) {
+        int newCapacity = *listCapacity == 0 ? 16 : *listCapacity * 2;
+        while (newCapacity <= key) {
+            newCapacity *= 2;
         }
-        else {
-            validInput = true; // Password is valid, break out of the loop
+        HandleList *grown = realloc(*lists, newCapacity * sizeof(HandleList));
+        if (grown == NULL) {
+            perror("Failed to allocate memory for index");
+            return false;
         }
+        memset(&grown[*listCapacity], 0, (newCapacity - *listCapacity) * sizeof(HandleList));
+        *lists = grown;
+        *listCapacity = newCapacity;
     }
-    return strdup(input_password); // Dynamically allocate memory and copy the password
+
+    HandleList *list = &(*lists)[key];
+    if (!growArray((void**)&list->handles, list->count, &list->capacity, sizeof(int))) {
+        return false;
+    }
+    list->handles[list->count++] = handle;
+    return true;
 }
 
 
-// Function to prompt for user role and validate, returning a dynamically allocated string
-char* promptValidRole() {
-    char input_role[ROLE_LENGTH];
-    int numRole = 0;
-    bool validInput = false;
+// Function to make room for one more element in a growable array
+// Doubles the capacity when the array is full so appends are amortized O(1)
+bool growArray(void **items, int count, int *capacity, size_t itemSize) {
+    if (count < *capacity) {
+        return true; // Still room for one more
+    }
+
+    int newCapacity = *capacity == 0 ? 16 : *capacity * 2;
+    void *grown = realloc(*items, newCapacity * itemSize);
+    if (grown == NULL) {
+        perror("Failed to allocate memory");
+        return false;
+    }
+    *items = grown;
+    *capacity = newCapacity;
+    return true;
+}
+
+
+// Function to make room for one more element in an array that may still point into the snapshot mapping
+// The mapping can neither grow nor be freed, so a mapped array is first copied into memory of its own
+bool growMappedArray(void **items, int count, int *capacity, size_t itemSize, bool *mapped) {
+    if (!*mapped || count < *capacity) {
+        return growArray(items, count, capacity, itemSize);
+    }
+
+    int newCapacity = *capacity < 8 ? 16 : *capacity * 2;
+    void *own = malloc(newCapacity * itemSize);
+    if (own == NULL) {
+        perror("Failed to allocate memory");
+        return false;
+    }
+    memcpy(own, *items, count * itemSize);
+    *items = own;
+    *capacity = newCapacity;
+    *mapped = false;
+    return true;
+}
+
+
+// Function to get the key of the entry at a position of a keyed heap
+// Entries are entrySize bytes long and keep their long long key keyOffset bytes in
+long long keyedHeapKey(const KeyedHeap *heap, int position, size_t entrySize, size_t keyOffset) {
+    return *(const long long*)((const char*)heap->items + position * entrySize + keyOffset);
+}
+
+
+// Function to add an entry to a keyed heap
+// Returns false if the heap could not grow
+bool pushKeyedHeap(KeyedHeap *heap, const void *entry, size_t entrySize, size_t keyOffset) {
+    if (!growArray(&heap->items, heap->count, &heap->capacity, entrySize)) {
+        return false;
+    }
+
+    // Sift the new entry up past every later key
+    char *items = heap->items;
+    long long key = *(const long long*)((const char*)entry + keyOffset);
+    int position = heap->count++;
+    while (position > 0 && keyedHeapKey(heap, (position - 1) / 2, entrySize, keyOffset) > key) {
+        memcpy(items + position * entrySize, items + (position - 1) / 2 * entrySize, entrySize);
+        position = (position - 1) / 2;
+    }
+    memcpy(items + position * entrySize, entry, entrySize);
+    return true;
+}
+
+
+// Function to remove the entry with the smallest key from a keyed heap
+void popKeyedHeap(KeyedHeap *heap, size_t entrySize, size_t keyOffset) {
+    if (heap->count == 0) {
+        return;
+    }
+
+    // Move the last entry to the root and sift it down below every smaller key
+    // The last entry stays where it is until then, since the sift only writes positions before it
+    char *items = heap->items;
+    int count = --heap->count;
+    long long lastKey = keyedHeapKey(heap, count, entrySize, keyOffset);
+    int position = 0;
+    while (2 * position + 1 < count) {
+        int child = 2 * position + 1;
+        if (child + 1 < count && keyedHeapKey(heap, child + 1, entrySize, keyOffset) < keyedHeapKey(heap, child, entrySize, keyOffset)) {
+            child++;
+        }
+        if (keyedHeapKey(heap, child, entrySize, keyOffset) >= lastKey) {
+            break;
+        }
+        memcpy(items + position * entrySize, items + child * entrySize, entrySize);
+        position = child;
+    }
+    memmove(items + position * entrySize, items + count * entrySize, entrySize);
+}
+
+
+// USER FUNCTIONS
+
+// Function to save users to file
+// The users are written to a temporary file that then replaces the users file, so a crash never leaves it half-written
+void saveUsers(UserStore *users) {
+    // Open the temporary users file in write mode
+    FILE *file = fopen(USERS_TEMP_FILE, "w");
+    // Check if the file was successfully opened
+    if (file == NULL) {
+        printf("Error: Unable to open users file for writing.\n");
+        return;
+    }
+
+    // Write user data to the file, numbering the live users in slot order
+    int orderNum = 0;
+    for (int i = 0; i < users->count; i++) {
+        if (users->items[i].deleted) {
+            continue; // Deleted users are dropped from the file
+        }
+        orderNum++;
+        fprintf(file, "%d, %s, %s, %s, %s, %d\n", orderNum, users->items[i].name, users->items[i].id, users->items[i].password, users->items[i].role, users->items[i].active);
+    }
+
+    // Put the file in place; it now reflects every journaled deletion, so the journal goes
+    replaceFile(users->disk, file, USERS_TEMP_FILE, USERS_FILE, USERS_JOURNAL_FILE);
+}
+
+
+// Function to load users from file
+int loadUsers(UserStore *users) {
+    RecordReader reader;
+    // Read the whole users file
+    if (!openRecordReader(&reader, USERS_FILE)) {
+        printf("Error: Unable to open users file for reading.\n");
+        users->count = 0;
+        return 0; // No users file found, start with empty user list
+    }
+
+    users->count = 0; // Initialize user count
+    char *fields[USER_FIELDS + 1];
+    int fieldCount;
+    // Read user data from the file
+    while ((fieldCount = nextRecord(&reader, fields, USER_FIELDS)) != -1) {
+        // The leading order number is positional and not kept
+        User user;
+        int orderNum;
+        if (fieldCount != USER_FIELDS) {
+            reportMalformedRecord(&reader, "expected 6 fields");
+            continue;
+        }
+        if (!parseIntField(fields[0], &orderNum) || !copyField(user.name, fields[1], NAME_LENGTH) ||
+            !copyField(user.id, fields[2], ID_LENGTH) || !copyField(user.password, fields[3], PASSWORD_LENGTH) ||
+            !copyField(user.role, fields[4], ROLE_LENGTH) || !parseIntField(fields[5], &user.active)) {
+            reportMalformedRecord(&reader, "invalid field");
+            continue;
+        }
+        user.deleted = false;
+
+        if (!growMappedArray((void**)&users->items, users->count, &users->capacity, sizeof(User), &users->itemsMapped)) {
+            break; // Keep the users loaded so far
+        }
+        users->items[users->count] = user;
+        users->count++; // Increment user count
+    }
+
+    closeRecordReader(&reader);
+    indexUsers(users); // Build the user ID index
+
+    // Apply the deletions made since the file was written, and fold a long journal back into it
+    if (replayUserJournal(users) > JOURNAL_COMPACT_THRESHOLD) {
+        saveUsers(users);
+    }
+    return 1; // Users loaded successfully
+}
+
+
+// Function to append a user deletion to the users journal
+void journalDeleteUser(UserStore *users, const char *id) {
+    // D: ID of a user deleted after the users file was written
+    char record[ID_LENGTH + 4];
+    int length = snprintf(record, sizeof(record), "D, %s\n", id);
+
+    if (!appendToFile(users->disk, USERS_JOURNAL_FILE, record, length)) {
+        perror("Error: Unable to write users journal");
+    }
+}
+
+
+// Function to replay the users journal over the users loaded from the file
+// Returns the number of journal records applied
+int replayUserJournal(UserStore *users) {
+    RecordReader reader;
+    if (!openRecordReader(&reader, USERS_JOURNAL_FILE)) {
+        return 0; // No journal, the users file is up to date
+    }
+
+    int replayed = 0;
+    char *fields[2 + 1];
+    int fieldCount;
+    while ((fieldCount = nextRecord(&reader, fields, 2)) != -1) {
+        if (fieldCount != 2 || strcmp(fields[0], "D") != 0) {
+            reportMalformedRecord(&reader, "expected D and a user ID");
+            continue;
+        }
+
+        // The user may already be gone if a save was interrupted before the journal was removed
+        int position = findUserIndex(users, fields[1]);
+        if (position != -1 && !releaseUserSlot(users, position)) {
+            printf("Error: Unable to delete user '%s' from the users journal.\n", fields[1]);
+        }
+        replayed++;
+    }
+
+    closeRecordReader(&reader);
+    return replayed;
+}
+
+
+// Function to rebuild the user ID index from the positions of every user
+void indexUsers(UserStore *users) {
+    clearSlotIndex(&users->idIndex);
+    reserveSlotIndex(&users->idIndex, users->count, hashUserEntry, users);
+
+    // Index the live users and put the slots of deleted ones back on the free list
+    users->freeCount = 0;
+    for (int i = 0; i < users->count; i++) {
+        if (!users->items[i].deleted) {
+            indexUser(users, i);
+        } else if (growArray((void**)&users->freeSlots, users->freeCount, &users->freeCapacity, sizeof(int))) {
+            users->freeSlots[users->freeCount++] = i;
+        }
+    }
+}
+
+
+// Function to hash the ID of the user at a position
+unsigned int hashUserEntry(const void *users, int position) {
+    return hashString(((const UserStore*)users)->items[position].id);
+}
+
+
+// Function to check whether the user at a position has a given ID
+bool matchUserEntry(const void *users, int position, const void *id) {
+    return strcmp(((const UserStore*)users)->items[position].id, id) == 0;
+}
+
+
+// Function to add the user at a position to the user ID index
+// Returns false if the index could not grow to take it
+bool indexUser(UserStore *users, int position) {
+    return addSlotEntry(&users->idIndex, position, hashUserEntry, users);
+}
+
+
+// Function to remove the user at a position from the user ID index
+void unindexUser(UserStore *users, int position) {
+    removeSlotEntry(&users->idIndex, position, hashUserEntry, users);
+}
+
+
+// Function to find a slot for a new user, reusing the slot of a deleted user when there is one
+// Returns the position of the slot, or -1 if the users array could not grow
+int allocateUserSlot(UserStore *users) {
+    if (users->freeCount > 0) {
+        users->freeCount--;
+        return users->freeSlots[users->freeCount];
+    }
+    if (!growMappedArray((void**)&users->items, users->count, &users->capacity, sizeof(User), &users->itemsMapped)) {
+        return -1;
+    }
+    return users->count++;
+}
+
+
+// Function to give back a slot taken by allocateUserSlot when the new user could not be stored after all
+// The free list still has room for the slot, since allocating it either took it from there or added none
+void returnUserSlot(UserStore *users, int position) {
+    users->items[position].deleted = true;
+    if (position == users->count - 1) {
+        users->count--;
+    } else {
+        users->freeSlots[users->freeCount++] = position;
+    }
+}
+
+
+// Function to delete the user at a position without moving any other user
+// The slot stays in the array as a tombstone until a new user takes it from the free list
+// Returns false, leaving the user in place, if the free list could not grow
+bool releaseUserSlot(UserStore *users, int position) {
+    if (!growArray((void**)&users->freeSlots, users->freeCount, &users->freeCapacity, sizeof(int))) {
+        return false; // Keep the user rather than lose track of the slot
+    }
+    unindexUser(users, position);
+    users->items[position].deleted = true;
+    users->freeSlots[users->freeCount++] = position;
+    return true;
+}
+
+
+// Function to find the position of a user by ID, or -1 if there is no such user
+// Users are indexed in position order, so a duplicated ID finds its first user as a scan would
+int findUserIndex(UserStore *users, const char *id) {
+    return findSlotEntry(&users->idIndex, hashString(id), matchUserEntry, users, id);
+}
+
+
+// Function to add administrator information to the file
+void addAdministratorInfoToFile(UserStore *users) {
+    
+    // Check if administrator information already exists
+    int i = findUserIndex(users, "admin");
+    if (i != -1 && strcmp(users->items[i].password, "admin") == 0 && strcmp(users->items[i].role, "Administrator") == 0 && users->items[i].active == 1) {
+        return;
+    }
+
+    // Add administrator information to the users array
+    int position = allocateUserSlot(users);
+    if (position == -1) {
+        return;
+    }
+    User *admin = &users->items[position];
+    strcpy(admin->name, "Administrator"); // Set the name for the administrator
+    strcpy(admin->id, "admin"); // Set the ID for the administrator
+    strcpy(admin->password, "admin"); // Set the password for the administrator
+    strcpy(admin->role, "Administrator"); // Set the role for the administrator
+    admin->active = 1; // Set the status as active for the administrator
+    admin->deleted = false;
+    if (!indexUser(users, position)) { // Make the administrator reachable by ID
+        printf("Error: Unable to store the administrator account.\n");
+        returnUserSlot(users, position);
+        return;
+    }
+
+    // Save the updated users array to file
+    saveUsers(users);
+}
+
+
+// Function to prompt for user name and validate, returning a dynamically allocated string
+char* promptValidName() {
+    char input_name[NAME_LENGTH];
+    bool validInput = false;
+    while (!validInput) {
+        printf("\nEnter name: ");
+        fgets(input_name, NAME_LENGTH, stdin);
+        input_name[strcspn(input_name, "\n")] = '\0'; // Remove newline character
+
+        // Check if name exceeds the maximum length
+        if (strlen(input_name) > (int)(NAME_LENGTH - 2)) {
+            printf("Name is too long. Please enter a name with at most %d characters.\n", NAME_LENGTH - 2);
+            clearInputBuffer(); // Clear any extra characters from the input buffer
+        }
+        // Check if name contains any numeric characters
+        else if (containNumeric(input_name)) {
+            printf("Name should not contain numeric characters. Please try again.\n");
+        }
+        // Check if name contains any comma characters
+        else if (containComma(input_name)) {
+            printf("Name should not contain comma characters. Please try again.\n");
+        }
+        // Check if name is empty
+        else if (isEmpty(input_name)) {
+            printf("Name cannot be empty. Please try again.\n");
+        }
+        else {
+            validInput = true;
+        }
+    }
+    return strdup(input_name); // Dynamically allocate memory and copy the name
+}
+
+
+// Function to prompt for user ID and validate, returning a dynamically allocated string
+char* promptValidID(UserStore *users) {
+    char input_id[ID_LENGTH];
+    bool validInput = false;
+    while (!validInput) {
+        printf("\nEnter ID: ");
+        fgets(input_id, ID_LENGTH, stdin);
+        input_id[strcspn(input_id, "\n")] = '\0'; // Remove newline character
+
+        // Check if username exceeds the maximum length
+        if (strlen(input_id) > (int)(ID_LENGTH - 2)) {
+            printf("ID is too long. Please enter an ID with at most %d characters.\n", ID_LENGTH - 2);
+            clearInputBuffer(); // Clear any extra characters from the input buffer
+        }
+        // Check if ID contains spaces
+        else if (containSpaces(input_id)) {
+            printf("ID should not contain spaces. Please try again.\n");
+        }
+        // Check if name contains any comma characters
+        else if (containComma(input_id)) {
+            printf("Name should not contain comma characters. Please try again.\n");
+        }
+        // Check if ID is empty
+        else if (isEmpty(input_id)) {
+            printf("ID cannot be empty. Please try again.\n");
+        }
+        else {
+            // Check if ID is already in use
+            if (findUserIndex(users, input_id) != -1) {
+                printf("ID is already in use. Please try again.\n");
+            } else {
+                validInput = true; // ID is valid, break out of the loop
+            }
+        }
+    }
+    return strdup(input_id); // Dynamically allocate memory and copy the ID
+}
+
+
+// Function to prompt for user password and validate, returning a dynamically allocated string
+char* promptValidPassword() {
+    char input_password[PASSWORD_LENGTH];
+    bool validInput = false;
+    while (!validInput) {
+        printf("\nEnter password: ");
+        fgets(input_password, PASSWORD_LENGTH, stdin);
+        input_password[strcspn(input_password, "\n")] = '\0'; // Remove newline character
+
+        // Check if password exceeds the maximum length
+        if (strlen(input_password) > (int)(PASSWORD_LENGTH - 2)) {
+            printf("Password is too long. Please enter a password with at most %d characters.\n", PASSWORD_LENGTH - 2);
+            clearInputBuffer(); // Clear any extra characters from the input buffer
+        }
+        // Check if password is empty
+        else if (isEmpty(input_password)) {
+            printf("Password cannot be empty. Please try again.\n");
+        }
+        else {
+            validInput = true; // Password is valid, break out of the loop
+        }
+    }
+    return strdup(input_password); // Dynamically allocate memory and copy the password
+}
+
+
+// Function to prompt for user role and validate, returning a dynamically allocated string
+char* promptValidRole() {
+    char input_role[ROLE_LENGTH];
+    int numRole = 0;
+    bool validInput = false;
     // Prompt user to select role
     do {
         printf("\n1. Hotel Staff\n2. Customer\n");
@@ -370,7 +1240,7 @@ char* promptValidRole() {
 
 
 // Function to register a new user
-void registerUser(User users[], int *userCount) {
+void registerUser(UserStore *users) {
 
     char *input_name, *input_id, *input_password, *input_role;
     bool validInput = false;
@@ -380,7 +1250,7 @@ void registerUser(User users[], int *userCount) {
         input_name = promptValidName();
 
         // Prompt user to enter ID
-        input_id = promptValidID(users, *userCount);
+        input_id = promptValidID(users);
 
         // Prompt user to enter password
         input_password = promptValidPassword();
@@ -388,16 +1258,33 @@ void registerUser(User users[], int *userCount) {
         // Prompt user to select role
         input_role = promptValidRole();
 
-        // Add user details to the users array
-        users[*userCount].orderNum = *userCount + 1; // Assign order number based on user count
-        strcpy(users[*userCount].name, input_name); // Copy name to user data
-        strcpy(users[*userCount].id, input_id); // Copy ID to user data
-        strcpy(users[*userCount].password, input_password); // Copy password to user data
-        strcpy(users[*userCount].role, input_role); // Copy role to user data
-        users[*userCount].active = 1; // Set user as active
+        // Add user details to the users array, in the slot of a deleted user if one is free
+        int position = allocateUserSlot(users);
+        if (position == -1) {
+            printf("Error: Unable to store the new user.\n");
+            free(input_name);
+            free(input_id);
+            free(input_password);
+            free(input_role);
+            return;
+        }
+        strcpy(users->items[position].name, input_name); // Copy name to user data
+        strcpy(users->items[position].id, input_id); // Copy ID to user data
+        strcpy(users->items[position].password, input_password); // Copy password to user data
+        strcpy(users->items[position].role, input_role); // Copy role to user data
+        users->items[position].active = 1; // Set user as active
+        users->items[position].deleted = false;
+        if (!indexUser(users, position)) { // Make the user reachable by ID
+            printf("Error: Unable to store the new user.\n");
+            returnUserSlot(users, position);
+            free(input_name);
+            free(input_id);
+            free(input_password);
+            free(input_role);
+            return;
+        }
 
-        (*userCount)++; // Increment user count
-        saveUsers(users, *userCount); // Save the new user to file
+        saveUsers(users); // Save the new user to file
         printf("\nUser Account Created Successfully.\n");
 
         // Free dynamically allocated memory
@@ -412,7 +1299,7 @@ void registerUser(User users[], int *userCount) {
 
 
 // Function to update user password
-void updateUserPassword(User users[], int *userCount) {
+void updateUserPassword(UserStore *users) {
 
     char input_id[ID_LENGTH];
     
@@ -425,26 +1312,24 @@ void updateUserPassword(User users[], int *userCount) {
         printf("Admin account cannot be updated.\n"); return;
     }
 
-    // Iterate through users to find the user by ID
-    for (int i = 0; i < *userCount; i++) {
-        // Check if the entered ID matches any user ID
-        if (strcmp(users[i].id, input_id) == 0) {
-            // Display current password for confirmation
-            printf("The current password: %s\n", users[i].password);
-            // Prompt user to enter new password
-            char* new_password = promptValidPassword();
-            if (strcmp(new_password, users[i].password) == 0) {
-                printf("New password can not be same as current password. Please try again.");
-                free(new_password); // Free dynamically allocated memory
-                return; // Exit the function
-            }
-            // Update the password for the user
-            strcpy(users[i].password, new_password);
-            saveUsers(users, *userCount); // Save the updated user data to file
-            printf("Password updated successfully for user '%s'.\n", input_id);
+    // Look the user up in the user ID index
+    int i = findUserIndex(users, input_id);
+    if (i != -1) {
+        // Display current password for confirmation
+        printf("The current password: %s\n", users->items[i].password);
+        // Prompt user to enter new password
+        char* new_password = promptValidPassword();
+        if (strcmp(new_password, users->items[i].password) == 0) {
+            printf("New password can not be same as current password. Please try again.");
             free(new_password); // Free dynamically allocated memory
             return; // Exit the function
         }
+        // Update the password for the user
+        strcpy(users->items[i].password, new_password);
+        saveUsers(users); // Save the updated user data to file
+        printf("Password updated successfully for user '%s'.\n", input_id);
+        free(new_password); // Free dynamically allocated memory
+        return; // Exit the function
     }
     // If no user with the entered ID is found, display a message
     printf("User '%s' not found.\n", input_id);
@@ -452,7 +1337,7 @@ void updateUserPassword(User users[], int *userCount) {
 
 
 // Function to update user status
-void updateUserStatus(User users[], int *userCount) {
+void updateUserStatus(UserStore *users) {
 
     char input_id[ID_LENGTH];
     int new_status = -1; // Initialize new_status to an invalid value to enter the while loop
@@ -466,36 +1351,34 @@ void updateUserStatus(User users[], int *userCount) {
         printf("Admin account can not be updated.\n"); return;
     }
 
-    // Iterate through users to find the user by ID
-    for (int i = 0; i < *userCount; i++) {
-        // Check if the entered ID matches any user ID
-        if (strcmp(users[i].id, input_id) == 0) {
-            // Display current user status
-            if (users[i].active == 1) {
-                printf("The current user status: Active\n");
-            } else {
-                printf("The current user status: Inactive\n");
-            }
-            
-            // Loop until a valid new status is entered
-            while (new_status != 0 && new_status != 1) {
-                // Prompt user to enter new status (1 for active, 0 for inactive)
-                printf("Enter new status (1 for active, 0 for inactive): ");
-                scanf("%d", &new_status); // Get status from user input
-                getchar(); // Remove newline character
-
-                // Check if the entered status is valid
-                if (new_status != 0 && new_status != 1) {
-                    printf("Invalid status. Please enter 1 for active or 0 for inactive.\n");
-                }
+    // Look the user up in the user ID index
+    int i = findUserIndex(users, input_id);
+    if (i != -1) {
+        // Display current user status
+        if (users->items[i].active == 1) {
+            printf("The current user status: Active\n");
+        } else {
+            printf("The current user status: Inactive\n");
+        }
+        
+        // Loop until a valid new status is entered
+        while (new_status != 0 && new_status != 1) {
+            // Prompt user to enter new status (1 for active, 0 for inactive)
+            printf("Enter new status (1 for active, 0 for inactive): ");
+            scanf("%d", &new_status); // Get status from user input
+            getchar(); // Remove newline character
+
+            // Check if the entered status is valid
+            if (new_status != 0 && new_status != 1) {
+                printf("Invalid status. Please enter 1 for active or 0 for inactive.\n");
             }
-            
-            // Update user status and save changes to file
-            users[i].active = new_status;
-            saveUsers(users, *userCount);
-            printf("Status updated successfully for user '%s'.\n", input_id);
-            return; // Exit the function
         }
+        
+        // Update user status and save changes to file
+        users->items[i].active = new_status;
+        saveUsers(users);
+        printf("Status updated successfully for user '%s'.\n", input_id);
+        return; // Exit the function
     }
     // If no user with the entered ID is found, display a message
     printf("User '%s' not found.\n", input_id);
@@ -503,7 +1386,7 @@ void updateUserStatus(User users[], int *userCount) {
 
 
 // Function to delete a user
-void deleteUser(User users[], int *userCount) {
+void deleteUser(UserStore *users) {
     
     char input_id[ID_LENGTH];
     printf("Enter ID to delete: ");
@@ -514,36 +1397,30 @@ void deleteUser(User users[], int *userCount) {
         printf("Admin account can not be deleted.\n"); return;
     }
 
-    // Iterate through the users to find the user by ID
-    for (int i = 0; i < *userCount; i++) {
-        // Check if the entered ID matches any user ID
-        if (strcmp(users[i].id, input_id) == 0) {
-            printf("\n=== User found ===\n");
-            printf("Name: %s\n", users[i].name);
-            printf("Role: %s\n", users[i].role);
-
-            int choice;
-            printf("Do you want to delete this user (Enter 1 for Yes): ");
-            scanf("%d", &choice);
-            getchar(); // Consume the newline character
-            if (choice != 1) {
-                printf("User not deleted.\n");
-                return; // Exit the function
-            }
-            
-            // Shift remaining users left to fill the gap
-            for (int j = i; j < *userCount - 1; j++) {
-                users[j] = users[j + 1];
-            }
-            (*userCount)--; // Decrease the user count
-            // Renumber the remaining users
-            for (int k = 0; k < *userCount; k++) {
-                users[k].orderNum = k + 1;
-            }
-            saveUsers(users, *userCount); // The * operator is used to dereference the pointer and get the value it points to. Save changes to file
-            printf("User '%s' deleted successfully.\n", input_id);
-            return; // Exit the function
+    // Look the user up in the user ID index
+    int i = findUserIndex(users, input_id);
+    if (i != -1) {
+        printf("\n=== User found ===\n");
+        printf("Name: %s\n", users->items[i].name);
+        printf("Role: %s\n", users->items[i].role);
+
+        int choice;
+        printf("Do you want to delete this user (Enter 1 for Yes): ");
+        scanf("%d", &choice);
+        getchar(); // Consume the newline character
+        if (choice != 1) {
+            printf("User not deleted.\n");
+            return; // Exit the function
+        }
+        
+        // Free the slot in place; every other user keeps its position
+        if (!releaseUserSlot(users, i)) {
+            printf("Error: Unable to delete user '%s'.\n", input_id);
+            return;
         }
+        journalDeleteUser(users, input_id); // Record just the deletion instead of rewriting the users file
+        printf("User '%s' deleted successfully.\n", input_id);
+        return; // Exit the function
     }
     // If no user with the entered ID is found, display a message
     printf("User '%s' not found.\n", input_id);
@@ -551,7 +1428,7 @@ void deleteUser(User users[], int *userCount) {
 
 
 // Function to display user details
-void displayUser(User users[], int *userCount) {
+void displayUser(UserStore *users) {
 
     char input_id[ID_LENGTH];
     
@@ -559,24 +1436,22 @@ void displayUser(User users[], int *userCount) {
     fgets(input_id, ID_LENGTH, stdin);
     input_id[strcspn(input_id, "\n")] = '\0'; // Remove newline character
 
-    // Iterate through the users to find the user by ID
-    for (int i = 0; i < *userCount; i++) {
-        // Check if the entered ID matches any user ID
-        if (strcmp(users[i].id, input_id) == 0) {
-            printf("\n-------------- User Details --------------\n");
-            printf("Name: %s\n", users[i].name);
-            printf("ID: %s\n", users[i].id);
-            printf("Password: %s\n", users[i].password);
-            printf("Role: %s\n", users[i].role);
-            // Check user status and display accordingly
-            if (users[i].active == 1) {
-                printf("Status: Active\n");
-            } else {
-                printf("Status: Inactive\n");
-            }
-            printf("------------------------------------------\n");
-            return; // Exit the function since the ID is found
+    // Look the user up in the user ID index
+    int i = findUserIndex(users, input_id);
+    if (i != -1) {
+        printf("\n-------------- User Details --------------\n");
+        printf("Name: %s\n", users->items[i].name);
+        printf("ID: %s\n", users->items[i].id);
+        printf("Password: %s\n", users->items[i].password);
+        printf("Role: %s\n", users->items[i].role);
+        // Check user status and display accordingly
+        if (users->items[i].active == 1) {
+            printf("Status: Active\n");
+        } else {
+            printf("Status: Inactive\n");
         }
+        printf("------------------------------------------\n");
+        return; // Exit the function since the ID is found
     }
     // If no user with the entered ID is found, display a message
     printf("ID user not found.\n");
@@ -584,7 +1459,7 @@ void displayUser(User users[], int *userCount) {
 
 
 // Function to check if a user is active
-char* checkUserStatus(User users[], int *userCount) {
+char* checkUserStatus(UserStore *users) {
     
     char* input_id = (char*)malloc(ID_LENGTH); // Allocate memory for input_id with space for ID_LENGTH characters
 
@@ -598,19 +1473,18 @@ char* checkUserStatus(User users[], int *userCount) {
     fgets(input_id, ID_LENGTH, stdin);
     input_id[strcspn(input_id, "\n")] = '\0'; // Remove newline character
 
-    // Search for the user by ID and check their status
-    for (int i = 0; i < *userCount; i++) {
-        if (strcmp(users[i].id, input_id) == 0) {
-            printf("User name: %s\n", users[i].name);
-            // Check if the user is a customer and active
-            if (strcmp(users[i].role, "Customer") == 0 && users[i].active == 1) {
-                return input_id; // Return the input ID if the user is active
-            } else {
-                // Display a message if the user is inactive or not a customer
-                printf("User ID '%s' is inactive or not a customer. Please contact the administrator.\n", input_id);
-                free(input_id); // Free dynamically allocated memory
-                return NULL; // Return NULL if the user is found but not active
-            }
+    // Look the user up in the user ID index
+    int i = findUserIndex(users, input_id);
+    if (i != -1) {
+        printf("User name: %s\n", users->items[i].name);
+        // Check if the user is a customer and active
+        if (strcmp(users->items[i].role, "Customer") == 0 && users->items[i].active == 1) {
+            return input_id; // Return the input ID if the user is active
+        } else {
+            // Display a message if the user is inactive or not a customer
+            printf("User ID '%s' is inactive or not a customer. Please contact the administrator.\n", input_id);
+            free(input_id); // Free dynamically allocated memory
+            return NULL; // Return NULL if the user is found but not active
         }
     }
 
@@ -635,7 +1509,7 @@ void displayMenuManageUsers() {
 
 
 // Function to manage users
-void manageUsers(User users[], int *userCount) {
+void manageUsers(UserStore *users) {
     int choice = 0; // Variable to store user's choice
     while (choice != 6) { // Continue the loop until the user chooses to exit
         displayMenuManageUsers(); // Display the menu options
@@ -645,11 +1519,11 @@ void manageUsers(User users[], int *userCount) {
         
         // Perform actions based on user's choice
         switch (choice) {
-            case 1: registerUser(users, userCount); break; // Register a new user
-            case 2: deleteUser(users, userCount); break; // Delete a user
-            case 3: updateUserPassword(users, userCount); break; // Update user password
-            case 4: updateUserStatus(users, userCount); break; // Update user status
-            case 5: displayUser(users, userCount); break; // Display user details
+            case 1: registerUser(users); break; // Register a new user
+            case 2: deleteUser(users); break; // Delete a user
+            case 3: updateUserPassword(users); break; // Update user password
+            case 4: updateUserStatus(users); break; // Update user status
+            case 5: displayUser(users); break; // Display user details
             case 6: printf("Exiting... Thank you!\n"); break; // Exit the loop
             default: printf("Invalid choice. Please try again.\n"); // Display message for invalid choice
         }
@@ -660,115 +1534,515 @@ void manageUsers(User users[], int *userCount) {
 // ROOM FUNCTIONS
 
 // Function to save rooms to file
-void saveRooms(Room rooms[], int roomCount) {
-    FILE *file = fopen(ROOMS_FILE, "w"); // Open the file for writing
+// The rooms are written to a temporary file that then replaces the rooms file, so a crash never leaves it half-written
+void saveRooms(RoomStore *rooms) {
+    FILE *file = fopen(ROOMS_TEMP_FILE, "w"); // Open the temporary file for writing
     if (file == NULL) {
         printf("Error: Unable to open rooms file for writing.\n");
         return;
     }
 
-    // Write each room's data to the file
-    for (int i = 0; i < roomCount; i++) {
-        if (rooms[i].type == STANDARD) { // Check if the room is a standard type
+    // Write each room's data to the file, numbering the live rooms in slot order
+    int orderNum = 0;
+    char amenities[AMENITIES_LENGTH];
+    for (int i = 0; i < rooms->count; i++) {
+        if (rooms->items[i].deleted) {
+            continue; // Deleted rooms are dropped from the file
+        }
+        orderNum++;
+        if (rooms->items[i].type == STANDARD) { // Check if the room is a standard type
             // Write standard room data to the file
             fprintf(file, "%d, %d, %d, %s, %.2f, %.2f, %d\n", 
-                    rooms[i].orderNum,
-                    rooms[i].id, 
-                    rooms[i].type, 
-                    rooms[i].details.standard.bedType, 
-                    rooms[i].rate, 
-                    rooms[i].details.standard.size,
-                    rooms[i].active);
-        } else if (rooms[i].type == SUITE) { // Check if the room is a suite type
-            // Write suite room data to the file
+                    orderNum,
+                    rooms->items[i].id, 
+                    rooms->items[i].type, 
+                    rooms->items[i].details.standard.bedType, 
+                    rooms->items[i].rate, 
+                    rooms->items[i].details.standard.size,
+                    rooms->items[i].active);
+        } else if (rooms->items[i].type == SUITE) { // Check if the room is a suite type
+            // Write suite room data to the file, with the amenity set spelled out by name
+            formatAmenities(rooms, rooms->items[i].details.suite.amenities, amenities, AMENITIES_LENGTH);
             fprintf(file, "%d, %d, %d, %s, %.2f, %.2f, %s, %d\n", 
-                    rooms[i].orderNum,
-                    rooms[i].id, 
-                    rooms[i].type, 
-                    rooms[i].details.suite.bedType, 
-                    rooms[i].rate, 
-                    rooms[i].details.suite.size, 
-                    rooms[i].details.suite.amenities,
-                    rooms[i].active);
+                    orderNum,
+                    rooms->items[i].id, 
+                    rooms->items[i].type, 
+                    rooms->items[i].details.suite.bedType, 
+                    rooms->items[i].rate, 
+                    rooms->items[i].details.suite.size, 
+                    amenities,
+                    rooms->items[i].active);
         }
     }
 
-    fclose(file); // Close the file
+    // Put the file in place; it now reflects every journaled deletion, so the journal goes
+    replaceFile(rooms->disk, file, ROOMS_TEMP_FILE, ROOMS_FILE, ROOMS_JOURNAL_FILE);
 }
 
 
 // Function to load rooms from file
-void loadRooms(Room rooms[], int *roomCount) {
-    FILE *file = fopen(ROOMS_FILE, "r"); // Open the file for reading
-    if (file == NULL) {
+void loadRooms(RoomStore *rooms) {
+    RecordReader reader;
+    // Read the whole rooms file
+    if (!openRecordReader(&reader, ROOMS_FILE)) {
         printf("Error: Unable to open rooms file for reading.\n");
-        *roomCount = 0;
+        rooms->count = 0;
+        indexRooms(rooms); // Drop the rooms of an earlier load from the index and the catalog
+        buildRoomCatalog(rooms);
         return; // No rooms file found, start with an empty room list
     }
 
-    *roomCount = 0; // Initialize room count to zero
-    while (!feof(file) && *roomCount < MAX_ROOMS) { // Read data until end of file or maximum rooms reached
+    rooms->count = 0; // Initialize room count to zero
+    char *fields[SUITE_ROOM_FIELDS + 1];
+    int fieldCount;
+    while ((fieldCount = nextRecord(&reader, fields, SUITE_ROOM_FIELDS)) != -1) { // Read data until end of file
+        // The leading order number is positional and not kept
         Room room;
-        int type;
+        int orderNum, type;
         // Read room data from the file
-        if (fscanf(file, "%d, %d, %d,", &room.orderNum, &room.id, &type) != 3) break;
+        if (fieldCount < 3 || !parseIntField(fields[0], &orderNum) || !parseIntField(fields[1], &room.id) || !parseIntField(fields[2], &type)) {
+            reportMalformedRecord(&reader, "invalid room header");
+            continue;
+        }
         room.type = (RoomType)type;
+        room.deleted = false;
 
+        bool valid;
         if (room.type == STANDARD) { // Check if the room is a standard type
             // Read standard room data from the file
-            if (fscanf(file, " %25[^,], %f, %f, %d\n",
-                       room.details.standard.bedType,
-                       &room.rate,
-                       &room.details.standard.size,
-                       &room.active) != 4) break;
-
+            valid = fieldCount == STANDARD_ROOM_FIELDS &&
+                    copyField(room.details.standard.bedType, fields[3], BEDTYPE_LENGTH) &&
+                    parseFloatField(fields[4], &room.rate) &&
+                    parseFloatField(fields[5], &room.details.standard.size) &&
+                    parseIntField(fields[6], &room.active);
         } else if (room.type == SUITE) { // Check if the room is a suite type
             // Read suite room data from the file
-            if (fscanf(file, " %25[^,], %f, %f, %99[^,], %d\n",
-                       room.details.suite.bedType,
-                       &room.rate,
-                       &room.details.suite.size,
-                       room.details.suite.amenities,
-                       &room.active) != 5) break;
+            valid = fieldCount == SUITE_ROOM_FIELDS &&
+                    copyField(room.details.suite.bedType, fields[3], BEDTYPE_LENGTH) &&
+                    parseFloatField(fields[4], &room.rate) &&
+                    parseFloatField(fields[5], &room.details.suite.size) &&
+                    parseAmenities(rooms, fields[6], &room.details.suite.amenities) &&
+                    parseIntField(fields[7], &room.active);
+        } else {
+            valid = false;
+        }
+        if (!valid) {
+            reportMalformedRecord(&reader, "invalid room details");
+            continue;
+        }
+
+        if (!growMappedArray((void**)&rooms->items, rooms->count, &rooms->capacity, sizeof(Room), &rooms->itemsMapped)) {
+            break; // Keep the rooms loaded so far
+        }
+        rooms->items[rooms->count] = room; // Add the room to the rooms array
+        rooms->count++; // Increment room count
+    }
+
+    closeRecordReader(&reader); // Release the file buffer
+    indexRooms(rooms); // Rebuild the room ID index for the new positions
+    buildRoomCatalog(rooms); // Copy the searchable fields into their columns
+
+    // Apply the deletions made since the file was written, and fold a long journal back into it
+    if (replayRoomJournal(rooms) > JOURNAL_COMPACT_THRESHOLD) {
+        saveRooms(rooms);
+    }
+}
+
+
+// Function to append a room deletion to the rooms journal
+void journalDeleteRoom(RoomStore *rooms, int roomId) {
+    // D: ID of a room deleted after the rooms file was written
+    char record[32];
+    int length = snprintf(record, sizeof(record), "D, %d\n", roomId);
+
+    if (!appendToFile(rooms->disk, ROOMS_JOURNAL_FILE, record, length)) {
+        perror("Error: Unable to write rooms journal");
+    }
+}
+
+
+// Function to replay the rooms journal over the rooms loaded from the file
+// Returns the number of journal records applied
+int replayRoomJournal(RoomStore *rooms) {
+    RecordReader reader;
+    if (!openRecordReader(&reader, ROOMS_JOURNAL_FILE)) {
+        return 0; // No journal, the rooms file is up to date
+    }
+
+    int replayed = 0;
+    char *fields[2 + 1];
+    int fieldCount;
+    while ((fieldCount = nextRecord(&reader, fields, 2)) != -1) {
+        int roomId;
+        if (fieldCount != 2 || strcmp(fields[0], "D") != 0 || !parseIntField(fields[1], &roomId)) {
+            reportMalformedRecord(&reader, "expected D and a room ID");
+            continue;
+        }
+
+        // The room may already be gone if a save was interrupted before the journal was removed
+        int position = findRoomIndex(rooms, roomId);
+        if (position != -1 && !releaseRoomSlot(rooms, position)) {
+            printf("Error: Unable to delete room %d from the rooms journal.\n", roomId);
+        }
+        replayed++;
+    }
+
+    closeRecordReader(&reader);
+    return replayed;
+}
+
+
+// Function to hash a room ID for the room index
+unsigned int hashRoomId(int id) {
+    return (unsigned int)(((unsigned long long)(unsigned int)id * 0x9E3779B97F4A7C15ull) >> 32); // Fibonacci hashing spreads consecutive IDs
+}
+
+
+// Function to rebuild the room ID index from the positions of every room
+void indexRooms(RoomStore *rooms) {
+    clearSlotIndex(&rooms->idIndex);
+    reserveSlotIndex(&rooms->idIndex, rooms->count, hashRoomEntry, rooms);
+
+    // Index the live rooms and put the slots of deleted ones back on the free list
+    rooms->freeCount = 0;
+    for (int i = 0; i < rooms->count; i++) {
+        if (!rooms->items[i].deleted) {
+            indexRoom(rooms, i);
+        } else if (growArray((void**)&rooms->freeSlots, rooms->freeCount, &rooms->freeCapacity, sizeof(int))) {
+            rooms->freeSlots[rooms->freeCount++] = i;
+        }
+    }
+}
+
+
+// Function to hash the ID of the room at a position
+unsigned int hashRoomEntry(const void *rooms, int position) {
+    return hashRoomId(((const RoomStore*)rooms)->items[position].id);
+}
+
+
+// Function to check whether the room at a position has a given ID
+bool matchRoomEntry(const void *rooms, int position, const void *roomId) {
+    return ((const RoomStore*)rooms)->items[position].id == *(const int*)roomId;
+}
+
+
+// Function to add the room at a position to the room ID index
+// Returns false if the index could not grow to take it
+bool indexRoom(RoomStore *rooms, int position) {
+    return addSlotEntry(&rooms->idIndex, position, hashRoomEntry, rooms);
+}
+
+
+// Function to remove the room at a position from the room ID index
+void unindexRoom(RoomStore *rooms, int position) {
+    removeSlotEntry(&rooms->idIndex, position, hashRoomEntry, rooms);
+}
+
+
+// Function to find a slot for a new room, reusing the slot of a deleted room when there is one
+// Returns the position of the slot, or -1 if the rooms array could not grow
+int allocateRoomSlot(RoomStore *rooms) {
+    if (rooms->freeCount > 0) {
+        rooms->freeCount--;
+        return rooms->freeSlots[rooms->freeCount];
+    }
+    if (!growMappedArray((void**)&rooms->items, rooms->count, &rooms->capacity, sizeof(Room), &rooms->itemsMapped)) {
+        return -1;
+    }
+    return rooms->count++;
+}
+
+
+// Function to give back a slot taken by allocateRoomSlot when the new room could not be stored after all
+// The free list still has room for the slot, since allocating it either took it from there or added none
+void returnRoomSlot(RoomStore *rooms, int position) {
+    rooms->items[position].deleted = true;
+    if (position == rooms->count - 1) {
+        rooms->count--;
+    } else {
+        rooms->freeSlots[rooms->freeCount++] = position;
+    }
+}
+
+
+// Function to delete the room at a position without moving any other room
+// The slot stays in the array as a tombstone until a new room takes it from the free list
+// Returns false, leaving the room in place, if the free list could not grow
+bool releaseRoomSlot(RoomStore *rooms, int position) {
+    if (!growArray((void**)&rooms->freeSlots, rooms->freeCount, &rooms->freeCapacity, sizeof(int))) {
+        return false; // Keep the room rather than lose track of the slot
+    }
+    unindexRoom(rooms, position);
+    rooms->items[position].deleted = true;
+    rooms->freeSlots[rooms->freeCount++] = position;
+    catalogRoom(rooms, position); // Searches stop matching the slot
+    return true;
+}
+
+
+// Function to map a bed type name to its catalog code
+BedType bedTypeCode(const char *bedType) {
+    if (strcmp(bedType, "Single") == 0) {
+        return SINGLE_BED;
+    } else if (strcmp(bedType, "Double") == 0) {
+        return DOUBLE_BED;
+    }
+    return OTHER_BED;
+}
+
+
+// Function to grow every column of the room catalog to hold at least a number of rooms
+// Columns are a whole number of filter blocks long, and the rooms past the last slot are inactive
+bool reserveRoomCatalog(RoomCatalog *catalog, int capacity) {
+    if (capacity <= catalog->capacity) {
+        return true;
+    }
+    capacity = (capacity + ROOM_FILTER_BLOCK - 1) / ROOM_FILTER_BLOCK * ROOM_FILTER_BLOCK;
+
+    unsigned char *types = realloc(catalog->types, capacity * sizeof(unsigned char));
+    if (types != NULL) {
+        catalog->types = types;
+    }
+    unsigned char *bedTypes = realloc(catalog->bedTypes, capacity * sizeof(unsigned char));
+    if (bedTypes != NULL) {
+        catalog->bedTypes = bedTypes;
+    }
+    float *rates = realloc(catalog->rates, capacity * sizeof(float));
+    if (rates != NULL) {
+        catalog->rates = rates;
+    }
+    float *sizes = realloc(catalog->sizes, capacity * sizeof(float));
+    if (sizes != NULL) {
+        catalog->sizes = sizes;
+    }
+    unsigned long long *amenities = realloc(catalog->amenities, capacity * sizeof(unsigned long long));
+    if (amenities != NULL) {
+        catalog->amenities = amenities;
+    }
+    unsigned char *active = realloc(catalog->active, capacity * sizeof(unsigned char));
+    if (active != NULL) {
+        catalog->active = active;
+    }
+    if (types == NULL || bedTypes == NULL || rates == NULL || sizes == NULL || amenities == NULL || active == NULL) {
+        perror("Failed to allocate memory for room catalog");
+        return false; // The columns that did grow are kept, but the capacity stays as it was
+    }
+
+    // Clear the new rows so the filter kernels can run over them
+    int added = capacity - catalog->capacity;
+    memset(types + catalog->capacity, 0, added * sizeof(unsigned char));
+    memset(bedTypes + catalog->capacity, 0, added * sizeof(unsigned char));
+    memset(rates + catalog->capacity, 0, added * sizeof(float));
+    memset(sizes + catalog->capacity, 0, added * sizeof(float));
+    memset(amenities + catalog->capacity, 0, added * sizeof(unsigned long long));
+    memset(active + catalog->capacity, 0, added * sizeof(unsigned char));
+    catalog->capacity = capacity;
+    return true;
+}
+
+
+// Function to copy the searchable fields of the room at a position into the catalog columns
+void catalogRoom(RoomStore *rooms, int position) {
+    RoomCatalog *catalog = &rooms->catalog;
+    if (!reserveRoomCatalog(catalog, rooms->capacity)) {
+        return;
+    }
+
+    const Room *room = &rooms->items[position];
+    catalog->types[position] = room->type;
+    if (room->type == STANDARD) {
+        catalog->bedTypes[position] = bedTypeCode(room->details.standard.bedType);
+        catalog->sizes[position] = room->details.standard.size;
+        catalog->amenities[position] = 0; // Standard rooms have no amenities
+    } else {
+        catalog->bedTypes[position] = bedTypeCode(room->details.suite.bedType);
+        catalog->sizes[position] = room->details.suite.size;
+        catalog->amenities[position] = room->details.suite.amenities;
+    }
+    catalog->rates[position] = room->rate;
+    catalog->active[position] = room->active == 1 && !room->deleted; // Deleted slots never match
+}
+
+
+// Function to rebuild the room catalog from every room slot
+// Rows past the last slot are cleared, since a reload with fewer rooms leaves the old ones behind
+void buildRoomCatalog(RoomStore *rooms) {
+    for (int i = 0; i < rooms->count; i++) {
+        catalogRoom(rooms, i);
+    }
+    RoomCatalog *catalog = &rooms->catalog;
+    if (rooms->count < catalog->capacity) {
+        memset(catalog->active + rooms->count, 0, (catalog->capacity - rooms->count) * sizeof(unsigned char));
+    }
+}
+
+
+// Function to free the columns of the room catalog
+void freeRoomCatalog(RoomCatalog *catalog) {
+    free(catalog->types);
+    free(catalog->bedTypes);
+    free(catalog->rates);
+    free(catalog->sizes);
+    free(catalog->amenities);
+    free(catalog->active);
+    memset(catalog, 0, sizeof(RoomCatalog));
+}
+
+
+// Function to set a room filter that matches every active room
+void initRoomFilter(RoomFilter *filter) {
+    filter->type = -1;
+    filter->bedType = -1;
+    filter->minRate = -FLT_MAX;
+    filter->maxRate = FLT_MAX;
+    filter->minSize = -FLT_MAX;
+    filter->maxSize = FLT_MAX;
+    filter->allAmenities = 0;
+    filter->anyAmenities = 0;
+}
+
+
+// Function to clear the mask of every room in a block whose column value differs from a value
+// Each kernel is a branch-free loop of fixed length over one dense column, which compilers turn into SIMD code
+void maskRoomsEqual(unsigned char *restrict mask, const unsigned char *restrict column, unsigned char value) {
+    for (int i = 0; i < ROOM_FILTER_BLOCK; i++) {
+        mask[i] &= column[i] == value;
+    }
+}
+
+
+// Function to clear the mask of every room in a block whose column value is outside an inclusive range
+void maskRoomsInRange(unsigned char *restrict mask, const float *restrict column, float min, float max) {
+    for (int i = 0; i < ROOM_FILTER_BLOCK; i++) {
+        mask[i] &= (column[i] >= min) & (column[i] <= max);
+    }
+}
+
+
+// Function to clear the mask of every room in a block that lacks any of a set of amenities
+void maskRoomsWithAll(unsigned char *restrict mask, const unsigned long long *restrict column, unsigned long long amenities) {
+    for (int i = 0; i < ROOM_FILTER_BLOCK; i++) {
+        mask[i] &= (column[i] & amenities) == amenities;
+    }
+}
+
+
+// Function to clear the mask of every room in a block that has none of a set of amenities
+void maskRoomsWithAny(unsigned char *restrict mask, const unsigned long long *restrict column, unsigned long long amenities) {
+    for (int i = 0; i < ROOM_FILTER_BLOCK; i++) {
+        mask[i] &= (column[i] & amenities) != 0;
+    }
+}
+
+
+// Function to get the length of the positions array that filterRooms needs: every room slot,
+// rounded up to the whole filter blocks the kernels work on
+int roomSearchLength(RoomStore *rooms) {
+    return (rooms->count / ROOM_FILTER_BLOCK + 1) * ROOM_FILTER_BLOCK;
+}
+
+
+// Function to find the active rooms that meet every condition of a filter in one pass over the catalog
+// Writes their positions to positions (roomSearchLength entries) in slot order and returns how many there are
+int filterRooms(RoomStore *rooms, const RoomFilter *filter, int *positions) {
+    const RoomCatalog *catalog = &rooms->catalog;
+    if (catalog->capacity < rooms->count) {
+        return 0; // The catalog could not grow to cover every room
+    }
+
+    unsigned char mask[ROOM_FILTER_BLOCK];
+    int matchCount = 0;
+
+    // Work through the columns a block at a time so the mask stays in cache between the kernels
+    for (int start = 0; start < rooms->count; start += ROOM_FILTER_BLOCK) {
+        // Start from the active rooms and let each condition in use clear the rooms that fail it
+        memcpy(mask, catalog->active + start, ROOM_FILTER_BLOCK);
+        if (filter->type != -1) {
+            maskRoomsEqual(mask, catalog->types + start, filter->type);
+        }
+        if (filter->bedType != -1) {
+            maskRoomsEqual(mask, catalog->bedTypes + start, filter->bedType);
+        }
+        if (filter->minRate != -FLT_MAX || filter->maxRate != FLT_MAX) {
+            maskRoomsInRange(mask, catalog->rates + start, filter->minRate, filter->maxRate);
+        }
+        if (filter->minSize != -FLT_MAX || filter->maxSize != FLT_MAX) {
+            maskRoomsInRange(mask, catalog->sizes + start, filter->minSize, filter->maxSize);
+        }
+        if (filter->allAmenities != 0) {
+            maskRoomsWithAll(mask, catalog->amenities + start, filter->allAmenities);
         }
+        if (filter->anyAmenities != 0) {
+            maskRoomsWithAny(mask, catalog->amenities + start, filter->anyAmenities);
+        }
+
+        // Gather the positions of the matches, skipping eight rooms at a time where none matched
+        int length = rooms->count - start < ROOM_FILTER_BLOCK ? rooms->count - start : ROOM_FILTER_BLOCK;
+        for (int i = 0; i < length; i += 8) {
+            unsigned long long eight;
+            memcpy(&eight, mask + i, sizeof(eight));
+            if (eight == 0) {
+                continue;
+            }
+            // Every position is written and only matches advance the count
+            for (int j = i; j < i + 8 && j < length; j++) {
+                positions[matchCount] = start + j;
+                matchCount += mask[j];
+            }
+        }
+    }
+    return matchCount;
+}
 
-        rooms[*roomCount] = room; // Add the room to the rooms array
-        (*roomCount)++; // Increment room count
+
+// Function to display every room that matches a filter, returning how many were displayed
+int displayMatchingRooms(RoomStore *rooms, const RoomFilter *filter) {
+    int *positions = malloc(roomSearchLength(rooms) * sizeof(int));
+    if (positions == NULL) {
+        perror("Failed to allocate memory for room search");
+        return 0;
+    }
+
+    int matchCount = filterRooms(rooms, filter, positions);
+    for (int i = 0; i < matchCount; i++) {
+        displayRoom(rooms, rooms->items[positions[i]].id); // Display the details of the room
     }
 
-    fclose(file); // Close the file
+    free(positions);
+    return matchCount;
+}
+
+
+// Function to find the position of a room by its ID, or -1 if there is no such room
+int findRoomIndex(RoomStore *rooms, int roomId) {
+    return findSlotEntry(&rooms->idIndex, hashRoomId(roomId), matchRoomEntry, rooms, &roomId);
 }
 
 
 // Function to prompt for and validate room ID
-int promptValidRoomID(Room rooms[], int roomCount) {
+int promptValidRoomID(RoomStore *rooms) {
     int roomID = 0;
     bool idExists = false;
     
     do {
         // Prompt user to enter room ID
-        printf("Enter room ID (between 101 and 151): ");
+        printf("Enter room ID (between %d and %d): ", MIN_ROOM_ID, MAX_ROOM_ID);
         scanf("%d", &roomID); 
         getchar(); // Remove newline character
         
-        if (roomID < 101 || roomID > 151) {
-            printf("Room ID must be between 101 and 151. Please try again.\n");
+        if (roomID < MIN_ROOM_ID || roomID > MAX_ROOM_ID) {
+            printf("Room ID must be between %d and %d. Please try again.\n", MIN_ROOM_ID, MAX_ROOM_ID);
             continue; // Prompt user to enter again
         }
 
         // Check for duplicate room ID
-        idExists = false; // Reset the flag
-        for (int i = 0; i < roomCount; i++) {
-            if (rooms[i].id == roomID) {
-                idExists = true;
-                break;
-            }
-        }
+        idExists = findRoomIndex(rooms, roomID) != -1;
 
         if (idExists) {
             printf("Room ID already exists. Please enter a different ID.\n");
         }
-    } while (roomID < 101 || roomID > 151 || idExists); // Repeat until a valid ID is entered
+    } while (roomID < MIN_ROOM_ID || roomID > MAX_ROOM_ID || idExists); // Repeat until a valid ID is entered
 
     return roomID;
 }
@@ -860,9 +2134,9 @@ int promptValidRoomType() {
 
 
 // Function to prompt for and validate room amenities
-char* promptValidAmenities() {
+unsigned long long promptValidAmenities(RoomStore *rooms) {
     int numAmenities = 0;
-    char amenitiesList[MAX_AMENITIES][AMENITY_LENGTH]; // Assuming each amenity can have up to 25 characters
+    unsigned long long amenities = 0; // Bit set of the amenities entered
 
     // Prompt user to enter the number of amenities
     do { 
@@ -877,64 +2151,118 @@ char* promptValidAmenities() {
 
     // Prompt user to enter each amenity
     for (int i = 0; i < numAmenities; i++) {
+        char amenity[AMENITY_LENGTH]; // Each amenity can have up to 25 characters
         printf("Enter room amenity %d: ", i + 1);
-        fgets(amenitiesList[i], AMENITY_LENGTH, stdin);
-        amenitiesList[i][strcspn(amenitiesList[i], "\n")] = '\0'; // Remove newline character
+        fgets(amenity, AMENITY_LENGTH, stdin);
+        amenity[strcspn(amenity, "\n")] = '\0'; // Remove newline character
 
         // Validate the entered amenity
-        if (isEmpty(amenitiesList[i])) {
+        if (isEmpty(amenity)) {
             printf("Amenity cannot be empty. Please try again!\n");
             i--; // Re-prompt for the current amenity
             continue;
         }
 
-        if (containComma(amenitiesList[i])) {
-            printf("Amenity cannot contain a comma character. Please try again!\n");
+        if (containComma(amenity) || strchr(amenity, '|') != NULL) {
+            printf("Amenity cannot contain a comma or '|' character. Please try again!\n");
             i--; // Re-prompt for the current amenity
             continue;
         }
 
-        if (containNumeric(amenitiesList[i])) {
+        if (containNumeric(amenity)) {
             printf("Amenity cannot contain numeric characters. Please try again!\n");
             i--; // Re-prompt for the current amenity
             continue;
         }
+
+        // Look the amenity up in the dictionary, adding it if it is new
+        int bit = internAmenity(rooms, amenity);
+        if (bit == -1) {
+            printf("Rooms already use %d different amenities. Please enter one of the existing amenities!\n", MAX_AMENITY_NAMES);
+            i--; // Re-prompt for the current amenity
+            continue;
+        }
+        amenities |= 1ULL << bit;
     }
 
-    // Concatenate amenities into a single string separated by '|'
-    char* concatenatedAmenities = malloc(MAX_AMENITIES * (AMENITY_LENGTH)); // Allocate memory
-    if (concatenatedAmenities == NULL) {
-        // Handle memory allocation failure
-        printf("Error: Memory allocation failed.\n");
-        return NULL;
+    return amenities;
+}
+
+
+// Function to find the bit of an amenity in the amenity dictionary, adding the amenity if it is new
+// Returns -1 if the amenity is new and the dictionary already holds MAX_AMENITY_NAMES amenities
+int internAmenity(RoomStore *rooms, const char *name) {
+    int bit = findInternedString(&rooms->amenityNames, name);
+    if (bit != -1) {
+        return bit;
+    }
+    if (rooms->amenityNames.count == MAX_AMENITY_NAMES) {
+        return -1; // No bit left in the mask
     }
+    return internString(&rooms->amenityNames, name);
+}
+
 
-    strcpy(concatenatedAmenities, amenitiesList[0]);
-    for (int i = 1; i < numAmenities; i++) {
-        strcat(concatenatedAmenities, "|");
-        strcat(concatenatedAmenities, amenitiesList[i]);
+// Function to parse a '|' separated list of amenity names into an amenity bit set
+// Returns false for an empty or overlong name; a name that finds the dictionary full is reported and left out,
+// so the room itself is still loaded
+bool parseAmenities(RoomStore *rooms, const char *names, unsigned long long *amenities) {
+    char list[AMENITIES_LENGTH];
+    if (!copyField(list, names, AMENITIES_LENGTH)) {
+        return false;
     }
 
-    return concatenatedAmenities; // Dynamically allocated memory containing the concatenated amenities
-}
+    *amenities = 0;
+    char *name = list;
+    while (name != NULL) {
+        // Cut the list at the next separator
+        char *separator = strchr(name, '|');
+        if (separator != NULL) {
+            *separator = '\0';
+        }
+
+        if (strlen(name) >= AMENITY_LENGTH || isEmpty(name)) {
+            return false;
+        }
+        int bit = internAmenity(rooms, name);
+        if (bit == -1) {
+            printf("Warning: Rooms use more than %d different amenities, '%s' is left out.\n", MAX_AMENITY_NAMES, name);
+        } else {
+            *amenities |= 1ULL << bit;
+        }
 
+        name = separator != NULL ? separator + 1 : NULL;
+    }
+    return true;
+}
 
-// Function to add a new room
-void addRoom(Room rooms[], int *roomCount) {
 
-    if (*roomCount >= MAX_ROOMS) { // Check if maximum room capacity has been reached
-        printf("Error: Cannot add more rooms. The maximum capacity of %d rooms has been reached.\n", MAX_ROOMS);
-        return;
+// Function to write the names of the amenities in a bit set as a '|' separated list, in dictionary order
+void formatAmenities(RoomStore *rooms, unsigned long long amenities, char *buffer, int bufferSize) {
+    int length = 0;
+    buffer[0] = '\0';
+    for (int bit = 0; bit < rooms->amenityNames.count; bit++) {
+        if (amenities & (1ULL << bit)) {
+            length += snprintf(buffer + length, bufferSize - length, "%s%s", length > 0 ? "|" : "", internedString(&rooms->amenityNames, bit));
+            if (length >= bufferSize) {
+                return; // Truncated; every list read from the rooms file fits
+            }
+        }
     }
+}
+
+
+// Function to add a new room
+void addRoom(RoomStore *rooms) {
 
     int roomID, roomType;
     float roomSize, roomRate;
-    char *amenities = NULL, *bedType = NULL;
+    char *bedType = NULL;
     bool validInput = false;
 
     while (!validInput) {
         Room newRoom;
-        roomID = promptValidRoomID(rooms, *roomCount);
+        roomID = promptValidRoomID(rooms);
         roomSize = promptValidRoomSize();
         roomRate = promptValidRoomRate();
         bedType = promptValidRoomBedType();
@@ -949,20 +2277,31 @@ void addRoom(Room rooms[], int *roomCount) {
             strcpy(newRoom.details.suite.bedType, bedType);
             newRoom.details.suite.size = roomSize;
             if (roomType == 2) {
-                amenities = promptValidAmenities();
-                strcpy(newRoom.details.suite.amenities, amenities);
-                free(amenities); // Free dynamically allocated memory for amenities
+                newRoom.details.suite.amenities = promptValidAmenities(rooms);
             }
         }
 
-        newRoom.orderNum = *roomCount + 1; // Assign order number based on room count
         newRoom.id = roomID;
         newRoom.rate = roomRate;
         newRoom.active = 1;
+        newRoom.deleted = false;
 
-        rooms[*roomCount] = newRoom; // Add the new room to the rooms array
-        (*roomCount)++; // Increment room count
-        saveRooms(rooms, *roomCount); // Save the updated rooms to file
+        // Add the new room to the rooms array, in the slot of a deleted room if one is free
+        int position = allocateRoomSlot(rooms);
+        if (position == -1) {
+            printf("Error: Unable to store a new room.\n");
+            free(bedType);
+            return;
+        }
+        rooms->items[position] = newRoom;
+        if (!indexRoom(rooms, position)) { // Make it reachable by ID
+            printf("Error: Unable to store a new room.\n");
+            returnRoomSlot(rooms, position);
+            free(bedType);
+            return;
+        }
+        catalogRoom(rooms, position); // Make it visible to searches
+        saveRooms(rooms); // Save the updated rooms to file
         printf("Room added successfully.\n");
         free(bedType); // Free dynamically allocated memory for bedType
         validInput = true; // Break out of the loop as input is valid
@@ -971,43 +2310,31 @@ void addRoom(Room rooms[], int *roomCount) {
 
 
 // Function to delete a room
-void deleteRoom(Room rooms[], int *roomCount) {
+void deleteRoom(RoomStore *rooms) {
 
     int roomIDToDelete;
     printf("Enter room ID to delete: ");
     scanf("%d", &roomIDToDelete);
     getchar(); // Consume the newline character
 
-    bool roomFound = false;
-    for (int i = 0; i < *roomCount; i++) {
-        if (rooms[i].id == roomIDToDelete) {
-            // Shift remaining rooms left to fill the gap
-            for (int j = i; j < *roomCount - 1; j++) {
-                rooms[j] = rooms[j + 1];
-            }
-            (*roomCount)--;
-            roomFound = true;
-            break;
-        }
-    }
-    if (!roomFound) {
+    int position = findRoomIndex(rooms, roomIDToDelete);
+    if (position == -1) {
         printf("Room with ID %d not found.\n", roomIDToDelete);
         return;
     }
 
-    // Renumber the remaining rooms
-    for (int i = 0; i < *roomCount; i++) {
-        rooms[i].orderNum = i + 1;
+    // Free the slot in place; every other room keeps its position
+    if (!releaseRoomSlot(rooms, position)) {
+        printf("Error: Unable to delete room with ID %d.\n", roomIDToDelete);
+        return;
     }
-
-    // Save the updated rooms back to the file
-    saveRooms(rooms, *roomCount);
+    journalDeleteRoom(rooms, roomIDToDelete); // Record just the deletion instead of rewriting the rooms file
     printf("Room with ID %d deleted successfully.\n", roomIDToDelete);
 }
 
 
 // Function to update room status
-void updateRoomStatus(Room rooms[], int *roomCount) {
+void updateRoomStatus(RoomStore *rooms) {
 
     int roomIDToUpdate;
     int newStatus = -1;
@@ -1016,77 +2343,73 @@ void updateRoomStatus(Room rooms[], int *roomCount) {
     scanf("%d", &roomIDToUpdate);
     getchar(); // Consume the newline character
 
-    bool roomFound = false;
-    for (int i = 0; i < *roomCount; i++) {
-        if (rooms[i].id == roomIDToUpdate) {
-            roomFound = true;
-            // Display current room status
-            printf("Current status of room ID %d: %d\n", roomIDToUpdate, rooms[i].active);
-
-            // Prompt for new status until a valid input is given
-            while (newStatus != 1 && newStatus != 0) {
-                printf("Enter new status (1 for Active, 0 for Inactive): ");
-                scanf("%d", &newStatus);
-                getchar(); // Consume the newline character
+    int position = findRoomIndex(rooms, roomIDToUpdate);
+    if (position == -1) {
+        printf("Room with ID %d not found.\n", roomIDToUpdate);
+        return;
+    }
 
-                if (newStatus != 1 && newStatus != 0) {
-                    printf("Invalid status. Please enter 1 for Active or 0 for Inactive.\n");
-                }
-            }
+    // Display current room status
+    printf("Current status of room ID %d: %d\n", roomIDToUpdate, rooms->items[position].active);
 
-            rooms[i].active = newStatus;
-            break;
+    // Prompt for new status until a valid input is given
+    while (newStatus != 1 && newStatus != 0) {
+        printf("Enter new status (1 for Active, 0 for Inactive): ");
+        scanf("%d", &newStatus);
+        getchar(); // Consume the newline character
+
+        if (newStatus != 1 && newStatus != 0) {
+            printf("Invalid status. Please enter 1 for Active or 0 for Inactive.\n");
         }
     }
 
-    if (!roomFound) {
-        printf("Room with ID %d not found.\n", roomIDToUpdate);
-        return;
-    }
+    rooms->items[position].active = newStatus;
+    catalogRoom(rooms, position); // Keep searches in step with the new status
 
     // Save the updated rooms back to the file
-    saveRooms(rooms, *roomCount);
+    saveRooms(rooms);
     printf("Room with ID %d status updated successfully.\n", roomIDToUpdate);
 }
 
 
 // Function to check room's details
-void displayRoom(Room rooms[], int *roomCount, int roomId) {
+void displayRoom(RoomStore *rooms, int roomId) {
 
-    // Search for the room with the specified ID
-    for (int i = 0; i < *roomCount; i++) {
-        if (rooms[i].id == roomId) {
-            // Print room details
-            printf("\n------------ Room Details ------------\n");
-            printf("ID: %d\n", rooms[i].id);
-            if (rooms[i].type == STANDARD) {
-                printf("Type: Standard\n");
-                printf("Bed type: %s\n", rooms[i].details.standard.bedType);
-                printf("Room size: %.2f\n", rooms[i].details.standard.size);
-            } else {
-                printf("Type: Suite\n");
-                printf("Bed type: %s\n", rooms[i].details.suite.bedType);
-                printf("Room size: %.2f\n", rooms[i].details.suite.size);
-                printf("Amenities: %s\n", rooms[i].details.suite.amenities);
-            }
-            printf("Rate: %.2f RM\n", rooms[i].rate);
-            if (rooms[i].active == 1) {
-                printf("Status: Active\n");
-            } else {
-                printf("Status: Inactive\n");
-            }
-            printf("\n--------------------------------------\n");
-            return;
-        }
+    // Look the room up in the room ID index
+    int i = findRoomIndex(rooms, roomId);
+    if (i == -1) {
+        // If the room with the specified ID is not found
+        printf("Room ID %d not found.\n", roomId);
+        return;
     }
 
-    // If the room with the specified ID is not found
-    printf("Room ID %d not found.\n", roomId);
+    // Print room details
+    printf("\n------------ Room Details ------------\n");
+    printf("ID: %d\n", rooms->items[i].id);
+    if (rooms->items[i].type == STANDARD) {
+        printf("Type: Standard\n");
+        printf("Bed type: %s\n", rooms->items[i].details.standard.bedType);
+        printf("Room size: %.2f\n", rooms->items[i].details.standard.size);
+    } else {
+        printf("Type: Suite\n");
+        printf("Bed type: %s\n", rooms->items[i].details.suite.bedType);
+        printf("Room size: %.2f\n", rooms->items[i].details.suite.size);
+        char amenities[AMENITIES_LENGTH];
+        formatAmenities(rooms, rooms->items[i].details.suite.amenities, amenities, AMENITIES_LENGTH);
+        printf("Amenities: %s\n", amenities);
+    }
+    printf("Rate: %.2f RM\n", rooms->items[i].rate);
+    if (rooms->items[i].active == 1) {
+        printf("Status: Active\n");
+    } else {
+        printf("Status: Inactive\n");
+    }
+    printf("\n--------------------------------------\n");
 }
 
 
 // Function to search for rooms by type
-void searchByRoomType(Room rooms[], int *roomCount) {
+void searchByRoomType(RoomStore *rooms) {
     int roomType = 0;
     printf("Enter room type (1 for Standard, 2 for Suite): ");
     scanf("%d", &roomType); getchar();
@@ -1104,16 +2427,10 @@ void searchByRoomType(Room rooms[], int *roomCount) {
 
     // Print header for the available rooms of the specified type
     printf("\n================ %s Rooms ===============\n", roomTypeStr);
-    int found = 0; // Flag to check if any rooms are found
-    for (int i = 0; i < *roomCount; i++) {
-        if ((roomType == 1 && rooms[i].type == STANDARD) || 
-            (roomType == 2 && rooms[i].type == SUITE)) {
-            if (rooms[i].active == 1) {
-                displayRoom(rooms, roomCount, rooms[i].id); // Display the details of the room
-                found = 1; // Set the flag when a room is found
-            }
-        }
-    }
+    RoomFilter filter;
+    initRoomFilter(&filter);
+    filter.type = roomType == 1 ? STANDARD : SUITE;
+    int found = displayMatchingRooms(rooms, &filter); // Number of rooms found
 
     // If no rooms of the specified type are found
     if (!found) {
@@ -1123,7 +2440,7 @@ void searchByRoomType(Room rooms[], int *roomCount) {
 
 
 // Function to search for rooms by bed type
-void searchByBedType(Room rooms[], int *roomCount) {
+void searchByBedType(RoomStore *rooms) {
     int bedType;
     printf("Enter bed type (1 for Single or 2 for Double): ");
     scanf("%d", &bedType); getchar();
@@ -1141,16 +2458,10 @@ void searchByBedType(Room rooms[], int *roomCount) {
 
     // Print header for the available rooms with the specified bed type
     printf("\n============ %s Bedtype Rooms ===========\n", bedTypeStr);
-    int found = 0; // Flag to check if any rooms are found
-    for (int i = 0; i < *roomCount; i++) {
-        if (rooms[i].active == 1) {
-            if ((rooms[i].type == STANDARD && strcmp(rooms[i].details.standard.bedType, bedTypeStr) == 0) || 
-                (rooms[i].type == SUITE && strcmp(rooms[i].details.suite.bedType, bedTypeStr) == 0)) {
-                displayRoom(rooms, roomCount, rooms[i].id); // Display the details of the room
-                found = 1; // Set the flag when a room is found
-            }
-        }
-    }
+    RoomFilter filter;
+    initRoomFilter(&filter);
+    filter.bedType = bedTypeCode(bedTypeStr);
+    int found = displayMatchingRooms(rooms, &filter); // Number of rooms found
 
     // If no rooms with the specified bed type are found
     if (!found) {
@@ -1160,7 +2471,7 @@ void searchByBedType(Room rooms[], int *roomCount) {
 
 
 // Function to search for rooms by rate
-void searchByRate(Room rooms[], int *roomCount) {
+void searchByRate(RoomStore *rooms) {
     float minRate, maxRate;
     printf("Enter minimum rate (RM): ");
     scanf("%f", &minRate); getchar(); // Consume newline character
@@ -1169,13 +2480,11 @@ void searchByRate(Room rooms[], int *roomCount) {
 
     // Print header for the available rooms within the specified rate range
     printf("\n====== Rooms from %.2fRM to %.2fRM ======\n", minRate, maxRate);
-    int found = 0; // Flag to check if any rooms are found
-    for (int i = 0; i < *roomCount; i++) {
-        if (rooms[i].active == 1 && rooms[i].rate >= minRate && rooms[i].rate <= maxRate) {
-            displayRoom(rooms, roomCount, rooms[i].id); // Display the details of the room
-            found = 1; // Set the flag when a room is found
-        }
-    }
+    RoomFilter filter;
+    initRoomFilter(&filter);
+    filter.minRate = minRate;
+    filter.maxRate = maxRate;
+    int found = displayMatchingRooms(rooms, &filter); // Number of rooms found
 
     // If no rooms within the specified rate range are found
     if (!found) {
@@ -1184,44 +2493,148 @@ void searchByRate(Room rooms[], int *roomCount) {
 }
 
 
-// Function to search for available rooms
-void searchRooms(Room rooms[], int *roomCount) {
-    int choice = 0;    
-    do {
-        // Display the menu for searching available rooms
-        printf("\n========= Search For Room Details ==========\n");
-        printf("1. Search by Room Type\n");
-        printf("2. Search by Bed Type\n");
-        printf("3. Search by Rate\n");
-        printf("4. Back to Main Menu\n");
-        printf("============================================\n");
-        printf("Enter your choice: ");
-        scanf("%d", &choice); getchar(); // Consume the newline character
-        
-        // Perform actions based on user's choice
-        switch (choice) {
-            case 1:
-                searchByRoomType(rooms, roomCount);
-                break;
-            case 2:
-                searchByBedType(rooms, roomCount);
-                break;
-            case 3:
-                searchByRate(rooms, roomCount);
-                break;
-            case 4:
-                printf("Returning to main menu...\n");
-                break;
+// Function to search for rooms by type, bed type, rate and size at once
+void searchByFilters(RoomStore *rooms) {
+    int roomType, bedType;
+    RoomFilter filter;
+    initRoomFilter(&filter);
+
+    printf("Enter room type (0 for Any, 1 for Standard, 2 for Suite): ");
+    scanf("%d", &roomType); getchar();
+    printf("Enter bed type (0 for Any, 1 for Single, 2 for Double): ");
+    scanf("%d", &bedType); getchar();
+    if (roomType < 0 || roomType > 2 || bedType < 0 || bedType > 2) {
+        printf("Invalid room type or bed type entered.\n");
+        return;
+    }
+    printf("Enter minimum rate (RM): ");
+    scanf("%f", &filter.minRate); getchar(); // Consume newline character
+    printf("Enter maximum rate (RM): ");
+    scanf("%f", &filter.maxRate); getchar(); // Consume newline character
+    printf("Enter minimum size (square meters): ");
+    scanf("%f", &filter.minSize); getchar(); // Consume newline character
+    printf("Enter maximum size (square meters): ");
+    scanf("%f", &filter.maxSize); getchar(); // Consume newline character
+
+    // Narrow the type and bed type only when one was chosen
+    if (roomType != 0) {
+        filter.type = roomType == 1 ? STANDARD : SUITE;
+    }
+    if (bedType != 0) {
+        filter.bedType = bedType == 1 ? SINGLE_BED : DOUBLE_BED;
+    }
+
+    // Print header for the available rooms that meet every filter
+    printf("\n========== Rooms Matching Filters ==========\n");
+    int found = displayMatchingRooms(rooms, &filter); // Number of rooms found
+
+    // If no rooms meet every filter
+    if (!found) {
+        printf("No available rooms match the filters.\n");
+    }
+}
+
+
+// Function to search for rooms that have all, or any, of a list of amenities
+void searchByAmenities(RoomStore *rooms) {
+    int matchAll, numAmenities;
+    printf("Match all or any of the amenities (1 for All, 2 for Any): ");
+    scanf("%d", &matchAll); getchar();
+    if (matchAll != 1 && matchAll != 2) {
+        printf("Invalid choice entered.\n");
+        return;
+    }
+    printf("How many amenities (1-%d): ", MAX_AMENITIES);
+    scanf("%d", &numAmenities); getchar();
+    if (numAmenities < 1 || numAmenities > MAX_AMENITIES) {
+        printf("Please enter a number between 1 and %d.\n", MAX_AMENITIES);
+        return;
+    }
+
+    // Turn the names into a bit set; a name no room uses can never be matched
+    unsigned long long amenities = 0;
+    bool unknown = false;
+    for (int i = 0; i < numAmenities; i++) {
+        char amenity[AMENITY_LENGTH];
+        printf("Enter room amenity %d: ", i + 1);
+        fgets(amenity, AMENITY_LENGTH, stdin);
+        amenity[strcspn(amenity, "\n")] = '\0'; // Remove newline character
+
+        int bit = findInternedString(&rooms->amenityNames, amenity);
+        if (bit == -1) {
+            unknown = true;
+        } else {
+            amenities |= 1ULL << bit;
+        }
+    }
+
+    // Print header for the available rooms with the amenities
+    printf("\n========= Rooms With %s of the Amenities =========\n", matchAll == 1 ? "All" : "Any");
+    int found = 0; // Number of rooms found
+    if (matchAll == 1 ? !unknown : amenities != 0) {
+        RoomFilter filter;
+        initRoomFilter(&filter);
+        if (matchAll == 1) {
+            filter.allAmenities = amenities;
+        } else {
+            filter.anyAmenities = amenities;
+        }
+        found = displayMatchingRooms(rooms, &filter);
+    }
+
+    // If no rooms have the amenities
+    if (!found) {
+        printf("No available rooms with the specified amenities.\n");
+    }
+}
+
+
+// Function to search for available rooms
+void searchRooms(RoomStore *rooms) {
+    int choice = 0;    
+    do {
+        // Display the menu for searching available rooms
+        printf("\n========= Search For Room Details ==========\n");
+        printf("1. Search by Room Type\n");
+        printf("2. Search by Bed Type\n");
+        printf("3. Search by Rate\n");
+        printf("4. Search by Several Filters\n");
+        printf("5. Search by Amenities\n");
+        printf("6. Back to Main Menu\n");
+        printf("============================================\n");
+        printf("Enter your choice: ");
+        scanf("%d", &choice); getchar(); // Consume the newline character
+        
+        // Perform actions based on user's choice
+        switch (choice) {
+            case 1:
+                searchByRoomType(rooms);
+                break;
+            case 2:
+                searchByBedType(rooms);
+                break;
+            case 3:
+                searchByRate(rooms);
+                break;
+            case 4:
+                searchByFilters(rooms);
+                break;
+            case 5:
+                searchByAmenities(rooms);
+                break;
+            case 6:
+                printf("Returning to main menu...\n");
+                break;
             default:
                 printf("Invalid choice. Please try again.\n");
                 break;
         }
-    } while (choice != 4); // Continue the loop until the user chooses to go back to the main menu
+    } while (choice != 6); // Continue the loop until the user chooses to go back to the main menu
 }
 
 
 // Function to check if a room is active and display its details
-int checkRoomStatus(Room rooms[], int *roomCount) {
+int checkRoomStatus(RoomStore *rooms) {
 
     int roomIDToCheck;
 
@@ -1230,31 +2643,32 @@ int checkRoomStatus(Room rooms[], int *roomCount) {
     scanf("%d", &roomIDToCheck);
     getchar(); // Consume the newline character
 
-    // Search for the room by ID and check its status
-    for (int i = 0; i < *roomCount; i++) {
-        if (rooms[i].id == roomIDToCheck) {
-            if (rooms[i].active == 1) {
-                // Display room details if it's active
-                printf("\n------------ Room Details ------------\n");
-                printf("ID: %d\n", rooms[i].id);
-                if (rooms[i].type == STANDARD) {
-                    printf("Type: Standard\n");
-                    printf("Bed type: %s\n", rooms[i].details.standard.bedType);
-                    printf("Room size: %.2f\n", rooms[i].details.standard.size);
-                } else {
-                    printf("Type: Suite\n");
-                    printf("Bed type: %s\n", rooms[i].details.suite.bedType);
-                    printf("Room size: %.2f\n", rooms[i].details.suite.size);
-                    printf("Amenities: %s\n", rooms[i].details.suite.amenities);
-                }
-                printf("Rate: %.2f RM\n", rooms[i].rate);
-                printf("\n--------------------------------------\n");
-                return roomIDToCheck; // Return the room ID if it's active
+    // Look the room up by ID and check its status
+    int i = findRoomIndex(rooms, roomIDToCheck);
+    if (i != -1) {
+        if (rooms->items[i].active == 1) {
+            // Display room details if it's active
+            printf("\n------------ Room Details ------------\n");
+            printf("ID: %d\n", rooms->items[i].id);
+            if (rooms->items[i].type == STANDARD) {
+                printf("Type: Standard\n");
+                printf("Bed type: %s\n", rooms->items[i].details.standard.bedType);
+                printf("Room size: %.2f\n", rooms->items[i].details.standard.size);
             } else {
-                // Inform the user if the room is not active
-                printf("This room is unavailable at the moment.\n");
-                return -1; // Return -1 if the room is found but not active
+                printf("Type: Suite\n");
+                printf("Bed type: %s\n", rooms->items[i].details.suite.bedType);
+                printf("Room size: %.2f\n", rooms->items[i].details.suite.size);
+                char amenities[AMENITIES_LENGTH];
+                formatAmenities(rooms, rooms->items[i].details.suite.amenities, amenities, AMENITIES_LENGTH);
+                printf("Amenities: %s\n", amenities);
             }
+            printf("Rate: %.2f RM\n", rooms->items[i].rate);
+            printf("\n--------------------------------------\n");
+            return roomIDToCheck; // Return the room ID if it's active
+        } else {
+            // Inform the user if the room is not active
+            printf("This room is unavailable at the moment.\n");
+            return -1; // Return -1 if the room is found but not active
         }
     }
 
@@ -1277,7 +2691,7 @@ void displayMenuManageRooms() {
 
 
 // Function to manage rooms
-void manageRooms(Room rooms[], int roomCount) {
+void manageRooms(RoomStore *rooms) {
     int choice = 0;
     int roomId;
     while (choice != 5) {
@@ -1288,19 +2702,19 @@ void manageRooms(Room rooms[], int roomCount) {
         
         switch (choice) {
             case 1: 
-                addRoom(rooms, &roomCount); // Add a new room
+                addRoom(rooms); // Add a new room
                 break;
             case 2: 
-                deleteRoom(rooms, &roomCount); // Delete a room
+                deleteRoom(rooms); // Delete a room
                 break;
             case 3: 
-                updateRoomStatus(rooms, &roomCount); // Update room status
+                updateRoomStatus(rooms); // Update room status
                 break;
             case 4: 
                 printf("\nEnter room ID to check: "); 
                 scanf("%d", &roomId); 
                 getchar(); // Consume the newline character
-                displayRoom(rooms, &roomCount, roomId); // Check room details
+                displayRoom(rooms, roomId); // Check room details
                 break;
             case 5: 
                 printf("Exiting... Thank you!\n"); 
@@ -1315,704 +2729,3263 @@ void manageRooms(Room rooms[], int roomCount) {
 // BOOKING FUNCTIONS
 
 // Function to save bookings to file
-void saveBookings(Booking *head) {
-    FILE *file = fopen(BOOKINGS_FILE, "w");
+// Writes a full snapshot of the list and discards the journal, since every journaled change is now part of the snapshot.
+// The snapshot goes to a temporary file that then replaces the bookings file, so a crash never leaves it half-written
+void saveBookings(BookingStore *store) {
+    FILE *file = fopen(BOOKINGS_TEMP_FILE, "w");
     if (file == NULL) {
         perror("Error: Unable to open file for writing");
         return;
     }
 
-    // Traverse the linked list and write each booking data to the file
-    Booking *current = head;
-    while (current != NULL) {
-        fprintf(file, "%d, %d, %s, %d, %s, %s, %s, %s\n", 
-                current->orderNum, current->id, current->userId, current->roomId, current->status, 
-                current->bookingDate, current->checkInDate, current->checkOutDate);
-        current = current->next;
+    // Walk the arena in order and write each booking data to the file
+    for (int handle = 0; handle < store->count; handle++) {
+        fprintf(file, "%d, ", handle + 1);
+        writeBookingRecord(file, store, getBooking(store, handle));
     }
 
-    fclose(file);
+    // The snapshot now contains every journaled change
+    replaceFile(store->disk, file, BOOKINGS_TEMP_FILE, BOOKINGS_FILE, BOOKINGS_JOURNAL_FILE);
 }
 
 
 // Function to load bookings from file
-Booking* loadBookings(int *bookingCount) {
-    FILE *file = fopen(BOOKINGS_FILE, "r");
-    if (file == NULL) {
+// Reads the snapshot in bookings.txt and then replays the journal over it
+void loadBookings(BookingStore *store) {
+    RecordReader reader;
+    if (!openRecordReader(&reader, BOOKINGS_FILE)) {
         perror("Error: Unable to open bookings file for reading.\n");
-        return NULL; // Return NULL to indicate no bookings
+    } else {
+        char *fields[BOOKING_FIELDS + 1];
+        int fieldCount;
+
+        // Size the ID index from the file length (records are at least MIN_BOOKING_LINE bytes long)
+        // Sizing it once up front avoids rehashing the whole table every time it doubles
+        reserveSlotIndex(&store->idIndex, reader.size / MIN_BOOKING_LINE, hashBookingEntry, store);
+
+        // Read data from file and append each booking to the arena
+        while ((fieldCount = nextRecord(&reader, fields, BOOKING_FIELDS)) != -1) {
+            // The leading order number is positional and not kept
+            Booking record;
+            if (fieldCount != BOOKING_FIELDS || !parseBookingFields(store, fields + 1, &record)) {
+                reportMalformedRecord(&reader, "expected order number, ID, user, room, status and three dates");
+                continue;
+            }
+            if (appendBooking(store, &record) == NULL) {
+                break; // Keep the bookings loaded so far
+            }
+        }
+
+        closeRecordReader(&reader); // Release the file buffer
     }
 
-    Booking *head = NULL; // Initialize head of linked list to NULL
-    Booking *tail = NULL; // Initialize tail of linked list to NULL
-    *bookingCount = 0; // Initialize booking count to 0
+    // Apply the changes made since the snapshot was written
+    int replayed = replayBookingJournal(store);
 
-    // Read data from file and create linked list nodes
-    while (1) {
-        Booking *newNode = (Booking*)malloc(sizeof(Booking));
-        if (!newNode) {
-            perror("Failed to allocate memory for new booking");
-            return head; // Return the current state of the linked list
-        }
-
-        // Read data from file into the newNode
-        if (fscanf(file, "%d, %d, %[^,], %d, %[^,], %[^,], %[^,], %[^,\n]",
-                   &newNode->orderNum,
-                   &newNode->id,
-                   newNode->userId,
-                   &newNode->roomId,
-                   newNode->status,
-                   newNode->bookingDate,
-                   newNode->checkInDate,
-                   newNode->checkOutDate) != 8) {
-            free(newNode); // Free memory allocated for newNode
-            break; // Exit the loop if fscanf fails
-        }
-
-        // Set the next pointer of the newNode to NULL
-        newNode->next = NULL;
-
-        // Update the linked list
-        if (head == NULL) {
-            head = newNode; // If head is NULL, newNode becomes the head
-            tail = newNode; // If tail is NULL, newNode becomes the tail
-        } else {
-            tail->next = newNode; // Append newNode to the end of the list
-            tail = newNode; // Update the tail to newNode
+    // Fold a long journal back into the snapshot so startup stays fast
+    if (replayed > JOURNAL_COMPACT_THRESHOLD) {
+        saveBookings(store);
+    }
+
+    indexRoomStays(store);
+}
+
+
+// Function to index the stays that still hold their room
+void indexRoomStays(BookingStore *store) {
+    // Start the calendar horizon today
+    char currentDate[DATE_LENGTH];
+    getCurrentDate(currentDate, DATE_LENGTH);
+    store->calendarStart = dateToDayNumber(currentDate);
+
+    for (int handle = 0; handle < store->count; handle++) {
+        Booking *current = getBooking(store, handle);
+        if ((current->status == RESERVED || current->status == CHECKED_IN) && !addRoomStay(store, current)) {
+            store->staysIncomplete = true;
         }
+        if (current->status == RESERVED) {
+            pushCheckInDeadline(store, handle); // Watch it for a missed check-in
+        }
+    }
+
+    if (store->staysIncomplete) {
+        printf("Error: Unable to index every reservation. No new reservations can be made until the program is restarted.\n");
+    }
+}
+
+
+// Function to format the journal record of a new booking
+// Returns a malloc'd string, or NULL if it could not be allocated
+char* formatNewBookingRecord(BookingStore *store, const Booking *booking, size_t *length) {
+    char *record = NULL;
+    FILE *buffer = open_memstream(&record, length);
+    if (buffer == NULL) {
+        perror("Failed to allocate memory for bookings journal");
+        return NULL;
+    }
+
+    // A: full record of a booking created after the snapshot
+    fprintf(buffer, "A, ");
+    writeBookingRecord(buffer, store, booking);
 
-        (*bookingCount)++; // Increment the booking count
+    fclose(buffer);
+    return record;
+}
+
+
+// Function to append a new booking to the journal
+void journalAddBooking(BookingStore *store, const Booking *booking) {
+    size_t length;
+    char *record = formatNewBookingRecord(store, booking, &length);
+    if (record == NULL) {
+        return;
     }
 
-    fclose(file); // Close the file
-    return head; // Return the head of the linked list
+    if (!appendToFile(store->disk, BOOKINGS_JOURNAL_FILE, record, length)) {
+        perror("Error: Unable to write bookings journal");
+    }
+    free(record);
 }
 
 
-// Function to generate a unique ID by checking against the list of bookings
-int generateUniqueId(Booking* head) {
-    int id;
-    Booking* current;
+// Function to append a booking status change to the journal
+void journalUpdateStatus(BookingStore *store, long long id, BookingStatus status) {
+    // S: new status of an existing booking
+    char record[JOURNAL_STATUS_RECORD_LENGTH];
+    int length = snprintf(record, sizeof(record), "S, %lld, %s\n", id, bookingStatusName(status));
 
-    do {
-        id = (rand() % 900) + 100; // Generate ID between 100 and 999
-        current = head;
-        while (current != NULL) {
-            if (current->id == id) {
-                id = -1; // ID is not unique, set it to an invalid value to continue loop
+    if (!appendToFile(store->disk, BOOKINGS_JOURNAL_FILE, record, length)) {
+        perror("Error: Unable to write bookings journal");
+    }
+}
+
+
+// Function to append the same status change for many bookings to the journal in a single write
+void journalStatusChanges(BookingStore *store, const long long *ids, int count, BookingStatus status) {
+    // Format the whole batch first so it reaches the file in one write call
+    size_t capacity = (size_t)count * JOURNAL_STATUS_RECORD_LENGTH;
+    char *buffer = malloc(capacity);
+    if (buffer == NULL) {
+        perror("Failed to allocate memory for bookings journal");
+        return;
+    }
+    size_t length = 0;
+    for (int i = 0; i < count; i++) {
+        length += snprintf(buffer + length, capacity - length, "S, %lld, %s\n", ids[i], bookingStatusName(status));
+    }
+
+    if (!appendToFile(store->disk, BOOKINGS_JOURNAL_FILE, buffer, length)) {
+        perror("Error: Unable to write bookings journal");
+    }
+    free(buffer);
+}
+
+
+// Function to replay the journal over the bookings loaded from the snapshot
+// Returns the number of journal records applied
+int replayBookingJournal(BookingStore *store) {
+    RecordReader reader;
+    if (!openRecordReader(&reader, BOOKINGS_JOURNAL_FILE)) {
+        return 0; // No journal, the snapshot is up to date
+    }
+
+    int replayed = 0;
+    char *fields[BOOKING_FIELDS + 1];
+    int fieldCount;
+
+    while ((fieldCount = nextRecord(&reader, fields, BOOKING_FIELDS)) != -1) {
+        if (strcmp(fields[0], "A") == 0) {
+            // The fields after the tag are the same as a bookings.txt record without its order number
+            Booking record;
+            if (fieldCount != BOOKING_FIELDS || !parseBookingFields(store, fields + 1, &record)) {
+                reportMalformedRecord(&reader, "invalid new booking record");
+                continue;
+            }
+
+            // Skip bookings already in the snapshot (a compaction was interrupted before the journal was removed)
+            if (findBookingById(store, record.id) == NULL && appendBooking(store, &record) == NULL) {
                 break;
             }
-            current = current->next;
+        } else if (strcmp(fields[0], "S") == 0) {
+            long long id;
+            BookingStatus status = fieldCount == 3 ? parseBookingStatus(fields[2]) : INVALID_STATUS;
+            if (status == INVALID_STATUS || !parseLongLongField(fields[1], &id)) {
+                reportMalformedRecord(&reader, "invalid status record");
+                continue;
+            }
+
+            // Apply the status change to the matching booking
+            Booking *current = findBookingById(store, id);
+            if (current != NULL) {
+                current->status = (unsigned char)status;
+            }
+        } else {
+            reportMalformedRecord(&reader, "unknown journal record");
+            continue;
         }
-    } while (id == -1);
+        replayed++;
+    }
 
-    return id;
+    closeRecordReader(&reader);
+    return replayed;
 }
 
 
-// Function to add a booking node
-void addBookingNode(Booking **head, int *bookingCount, int uniqueId, const char *userId, int roomId, const char *bookingDate, const char *checkInDate, const char *checkOutDate) {
-    Booking *newBooking = (Booking*)malloc(sizeof(Booking));
-    if (!newBooking) {
-        perror("Failed to allocate memory for new booking");
-        return;
+// Function to parse the ID, user, room, status and dates of a booking from text fields
+bool parseBookingFields(BookingStore *store, char **fields, Booking *record) {
+    long long id;
+    int roomId;
+    if (!parseLongLongField(fields[0], &id) || isEmpty(fields[1]) || strlen(fields[1]) >= ID_LENGTH ||
+        !parseIntField(fields[2], &roomId) || parseBookingStatus(fields[3]) == INVALID_STATUS ||
+        !isValidDate(fields[4]) || !isValidDate(fields[5]) || !isValidDate(fields[6])) {
+        return false;
     }
-    newBooking->orderNum = *bookingCount + 1; // Increment booking order number
-    newBooking->id = uniqueId;
-    strcpy(newBooking->userId, userId);
-    newBooking->roomId = roomId;
-    strcpy(newBooking->status, "Reserved"); // Assuming status of newly created booking is 'Reserved'
-    strcpy(newBooking->bookingDate, bookingDate);
-    strcpy(newBooking->checkInDate, checkInDate);
-    strcpy(newBooking->checkOutDate, checkOutDate);
-    newBooking->next = NULL;
-
-    if (*head == NULL) {
-        *head = newBooking;
-    } else {
-        Booking *current = *head;
-        while (current->next != NULL) {
-            current = current->next;
+    *record = makeBookingRecord(store, id, fields[1], roomId, fields[3], fields[4], fields[5], fields[6]);
+    return true;
+}
+
+
+// Function to generate a unique booking ID
+// IDs are handed out in order from a block reserved for this terminal, so generation never retries or touches the disk
+long long generateUniqueId(BookingStore *store) {
+    if (store->idBlock.next >= store->idBlock.end) {
+        if (!reserveBookingIdBlock(store)) {
+            return -1; // Unable to reserve more IDs
         }
-        current->next = newBooking;
+    }
+    return store->idBlock.next++;
+}
+
+
+// Function to reserve the next block of booking IDs for this terminal
+// The high-water mark in BOOKING_IDS_FILE is advanced under an exclusive lock, so terminals sharing the
+// booking store always receive disjoint blocks; IDs left unused in a block are simply skipped
+int reserveBookingIdBlock(BookingStore *store) {
+    int fd = open(BOOKING_IDS_FILE, O_RDWR | O_CREAT, 0644);
+    if (fd == -1) {
+        perror("Error: Unable to open booking ID file");
+        return 0;
+    }
+    if (flock(fd, LOCK_EX) == -1) {
+        perror("Error: Unable to lock booking ID file");
+        close(fd);
+        return 0;
+    }
+
+    // Read the current high-water mark (the file is empty the first time)
+    char buffer[32] = {0};
+    long long highWaterMark = 0;
+    if (pread(fd, buffer, sizeof(buffer) - 1, 0) > 0) {
+        highWaterMark = atoll(buffer);
+    }
+
+    // Never hand out an ID at or below one that is already in use
+    long long start = highWaterMark > store->maxId + 1 ? highWaterMark : store->maxId + 1;
+    long long end = start + BOOKING_ID_BLOCK_SIZE;
+
+    // Persist the new high-water mark before any ID of the block is used
+    int length = snprintf(buffer, sizeof(buffer), "%lld\n", end);
+    int saved = ftruncate(fd, 0) == 0 && pwrite(fd, buffer, length, 0) == length;
+    if (!saved) {
+        perror("Error: Unable to write booking ID file");
     }
 
-    (*bookingCount)++;
+    flock(fd, LOCK_UN);
+    close(fd);
+
+    if (saved) {
+        store->idBlock.next = start;
+        store->idBlock.end = end;
+    }
+    return saved;
 }
 
 
-// Function to check room availability for booking
-int isRoomAvailableForBooking(Booking *head, int roomId, const char *checkInDate, const char *checkOutDate) {
-    Booking *current = head;
-    
-    while (current != NULL) {
-        if (current->roomId == roomId) {
-            // Check if the room is currently Reserved or Checked-In
-            if (strcmp(current->status, "Reserved") == 0 || strcmp(current->status, "Checked-In") == 0) {
-                // Check for overlap:
-                if (strcmp(checkInDate, current->checkInDate) >= 0 && strcmp(checkInDate, current->checkOutDate) < 0) {
-                    return 0; // Room is not available
-                }
-                if (strcmp(checkOutDate, current->checkInDate) > 0 && strcmp(checkOutDate, current->checkOutDate) <= 0) {
-                    return 0; // Room is not available
-                }
+// Function to find a booking by its ID
+Booking* findBookingById(BookingStore *store, long long id) {
+    int handle = findSlotEntry(&store->idIndex, hashBookingId(id), matchBookingEntry, store, &id);
+    return handle == -1 ? NULL : getBooking(store, handle);
+}
+
+
+// Function to hash a booking ID for the ID index
+unsigned int hashBookingId(long long id) {
+    unsigned long long hash = (unsigned long long)id * 0x9E3779B97F4A7C15ull; // Fibonacci hashing spreads consecutive IDs
+    return (unsigned int)(hash >> 32);
+}
+
+
+// Function to hash the ID of the booking under a handle
+unsigned int hashBookingEntry(const void *store, int handle) {
+    return hashBookingId(getBooking((BookingStore*)store, handle)->id);
+}
+
+
+// Function to check whether the booking under a handle has a given ID
+bool matchBookingEntry(const void *store, int handle, const void *id) {
+    return getBooking((BookingStore*)store, handle)->id == *(const long long*)id;
+}
+
+
+// Function to add a booking handle to the index of booking IDs
+void indexBookingId(BookingStore *store, int handle) {
+    if (!addSlotEntry(&store->idIndex, handle, hashBookingEntry, store)) {
+        return;
+    }
+
+    // Track the largest ID so new blocks always start above it
+    long long id = getBooking(store, handle)->id;
+    if (id > store->maxId) {
+        store->maxId = id;
+    }
+}
+
+
+// Function to get the booking stored under a handle
+Booking* getBooking(BookingStore *store, int handle) {
+    return &store->chunks[handle / BOOKING_CHUNK_SIZE][handle % BOOKING_CHUNK_SIZE];
+}
+
+
+// Function to append a copy of a booking to the arena
+// Returns the stored booking, whose address and handle never change afterwards, or NULL if it could not be stored
+Booking* appendBooking(BookingStore *store, const Booking *booking) {
+    // makeBookingRecord leaves the handle at -1 when the customer ID could not be interned
+    if (booking->userHandle < 0) {
+        printf("Error: Unable to store the customer ID of booking %lld.\n", booking->id);
+        return NULL;
+    }
+
+    int handle = store->count;
+
+    // Start a new chunk when the last one is full
+    if (handle % BOOKING_CHUNK_SIZE == 0) {
+        int chunk = handle / BOOKING_CHUNK_SIZE;
+        if (chunk == store->chunkCapacity) {
+            int newCapacity = store->chunkCapacity == 0 ? 16 : store->chunkCapacity * 2;
+            Booking **grown = realloc(store->chunks, newCapacity * sizeof(Booking*));
+            if (grown == NULL) {
+                perror("Failed to allocate memory for new booking");
+                return NULL;
             }
+            store->chunks = grown;
+            store->chunkCapacity = newCapacity;
+        }
+        store->chunks[chunk] = malloc(BOOKING_CHUNK_SIZE * sizeof(Booking));
+        if (store->chunks[chunk] == NULL) {
+            perror("Failed to allocate memory for new booking");
+            return NULL;
         }
-        current = current->next;
     }
 
-    return 1; // Room is available
+    Booking *stored = getBooking(store, handle);
+    *stored = *booking;
+    store->count++;
+    indexBookingId(store, handle); // Make the booking reachable by ID
+    indexUserBooking(store, handle); // And from its customer's booking list
+    if (store->dateIndexesBuilt) {
+        insertDateIndexes(store, handle); // And by its dates, once those indexes exist
+    }
+    return stored;
 }
 
 
-// Function to display booking details
-void displayBookingIdDetails(int *id, const char *userId, int *roomId, char *status, char *bookingDate, char *checkInDate, char *checkOutDate) {
-    printf("\n------------ Booking Details ------------");
-    printf("\nBooking ID: %d\n", *id);
-    printf("User ID: %s\n", userId);
-    printf("Room ID: %d\n", *roomId);
-    printf("Status: %s\n", status);
-    printf("Booking Date: %s\n", bookingDate);
-    printf("Check-In Date: %s\n", checkInDate);
-    printf("Check-Out Date: %s\n", checkOutDate);
-    printf("-----------------------------------------\n");
+// Function to get one of the dates of a booking
+int bookingDateOf(const Booking *booking, BookingDateField field) {
+    switch (field) {
+        case BOOKING_DATE_FIELD: return booking->bookingDate;
+        case CHECK_IN_DATE_FIELD: return booking->checkInDate;
+        default: return booking->checkOutDate;
+    }
 }
 
 
-// Function to free memory allocated for booking nodes
-void freeBookings(Booking *head) {
-    Booking *current = head;
-    while (current != NULL) {
-        Booking *next = current->next; // Store the next node to prevent losing reference
-        free(current); // Free memory for the current node
-        current = next; // Move to the next node
+// Function to order date index keys by day, then by handle
+int compareDateKeys(const void *a, const void *b) {
+    const DateKey *left = a;
+    const DateKey *right = b;
+    if (left->day != right->day) {
+        return left->day < right->day ? -1 : 1;
     }
+    return (left->handle > right->handle) - (left->handle < right->handle);
 }
 
 
-// Function to update order numbers of bookings
-void updateOrderNumbers(Booking *head) {
-    Booking *current = head;
-    int orderNum = 1;
+// Function to build the booking, check-in and check-out date indexes from every booking
+// Built on first use rather than at startup, since only the staff history report needs them
+bool buildDateIndexes(BookingStore *store) {
+    for (int field = 0; field < BOOKING_DATE_FIELD_COUNT; field++) {
+        DateIndex *index = &store->dateIndexes[field];
+        int capacity = store->count > 0 ? store->count : 1;
+        DateKey *keys = malloc(capacity * sizeof(DateKey));
+        if (keys == NULL) {
+            perror("Failed to allocate memory for booking date index");
+            return false;
+        }
+        for (int handle = 0; handle < store->count; handle++) {
+            keys[handle].day = bookingDateOf(getBooking(store, handle), field);
+            keys[handle].handle = handle;
+        }
+        qsort(keys, store->count, sizeof(DateKey), compareDateKeys);
 
-    // Traverse the list of bookings and update order numbers sequentially
-    while (current != NULL) {
-        current->orderNum = orderNum;
-        orderNum++;
-        current = current->next;
+        free(index->keys);
+        index->keys = keys;
+        index->count = store->count;
+        index->capacity = capacity;
     }
+    store->dateIndexesBuilt = true;
+    return true;
 }
 
 
-// Function to check room availability and make a reservation
-void makeReservation(Booking **head, int *bookingCount, Room rooms[], int *roomCount, const char* userId) {
+// Function to insert a new booking into the date indexes at its sorted position
+void insertDateIndexes(BookingStore *store, int handle) {
+    const Booking *booking = getBooking(store, handle);
+    for (int field = 0; field < BOOKING_DATE_FIELD_COUNT; field++) {
+        DateIndex *index = &store->dateIndexes[field];
+        if (!growArray((void**)&index->keys, index->count, &index->capacity, sizeof(DateKey))) {
+            store->dateIndexesBuilt = false; // Rebuild from scratch on next use
+            return;
+        }
 
-    int roomId;
-    char checkInDate[DATE_LENGTH], checkOutDate[DATE_LENGTH];
+        // The new handle is the largest, so it goes after every key with the same day
+        int day = bookingDateOf(booking, field);
+        int position = findDateIndexPosition(index, day + 1);
+        memmove(&index->keys[position + 1], &index->keys[position], (index->count - position) * sizeof(DateKey));
+        index->keys[position].day = day;
+        index->keys[position].handle = handle;
+        index->count++;
+    }
+}
 
-    // Check if room is active
-    roomId = checkRoomStatus(rooms, roomCount);
-    if (roomId == -1) {
-        return; // Exit if the room is not active
+
+// Function to find the first position in a date index whose day is on or after the given day
+int findDateIndexPosition(const DateIndex *index, int day) {
+    int low = 0, high = index->count;
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        if (index->keys[mid].day < day) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
     }
+    return low;
+}
 
-    // Get current date
-    char currentDate[DATE_LENGTH]; // Assuming YYYY-MM-DD format
-    getCurrentDate(currentDate, DATE_LENGTH); 
 
-    // Get valid check-in date (must be current date or later)
-    getValidDate(checkInDate, "Enter check-in date (YYYY-MM-DD): ", 0, currentDate);
-    
-    // Get valid check-out date (must be later than check-in date)
-    do {
-        getValidDate(checkOutDate, "Enter check-out date (YYYY-MM-DD): ", 0, checkInDate);
+// Function to add a booking to the posting list of its customer
+// Handles are appended in arena order, so each list stays in booking order
+void indexUserBooking(BookingStore *store, int handle) {
+    appendToHandleList(&store->userBookings, &store->userBookingCapacity, getBooking(store, handle)->userHandle, handle);
+}
 
-        // Check if check-out date is the same as or earlier than check-in date
-        if (strcmp(checkInDate, checkOutDate) >= 0) {
-            printf("Check-out date must be later than check-in date. Please enter again.\n");
+
+// Function to build a compact booking record from its text fields
+Booking makeBookingRecord(BookingStore *store, long long id, const char *userId, int roomId, const char *status, const char *bookingDate, const char *checkInDate, const char *checkOutDate) {
+    Booking record;
+    record.id = id;
+    record.roomId = roomId;
+    record.userHandle = internString(&store->userIds, userId); // Every booking of a user shares one copy of the ID; -1 if out of memory
+    record.bookingDate = dateToDayNumber(bookingDate);
+    record.checkInDate = dateToDayNumber(checkInDate);
+    record.checkOutDate = dateToDayNumber(checkOutDate);
+    record.status = (unsigned char)parseBookingStatus(status);
+    return record;
+}
+
+
+// Function to get the text name of a booking status
+const char* bookingStatusName(BookingStatus status) {
+    static const char *names[] = { "Reserved", "Checked-In", "Checked-Out", "Cancelled" };
+    return names[status];
+}
+
+
+// Function to parse the text name of a booking status
+// Returns INVALID_STATUS for anything else, so a damaged record is rejected rather than read as Reserved
+BookingStatus parseBookingStatus(const char *status) {
+    if (strcmp(status, "Reserved") == 0) return RESERVED;
+    if (strcmp(status, "Checked-In") == 0) return CHECKED_IN;
+    if (strcmp(status, "Checked-Out") == 0) return CHECKED_OUT;
+    if (strcmp(status, "Cancelled") == 0) return CANCELLED;
+    return INVALID_STATUS;
+}
+
+
+// Function to add a booking node
+// The caller journals the new booking
+Booking* addBookingNode(BookingStore *store, long long uniqueId, const char *userId, int roomId, const char *bookingDate, const char *checkInDate, const char *checkOutDate) {
+    // Assuming status of newly created booking is 'Reserved'
+    Booking record = makeBookingRecord(store, uniqueId, userId, roomId, "Reserved", bookingDate, checkInDate, checkOutDate);
+
+    // Make room for its stay first, so the booking is never stored without holding its room
+    if (reserveRoomStay(store, roomId) == NULL) {
+        return NULL;
+    }
+
+    // Append the booking to the end of the arena
+    Booking *newBooking = appendBooking(store, &record);
+    if (newBooking == NULL) {
+        return NULL;
+    }
+
+    // A new booking is Reserved, so it holds its room from now on and is cancelled if not checked in on time
+    addRoomStay(store, newBooking); // Cannot fail, the space was reserved above
+    pushCheckInDeadline(store, store->count - 1);
+    return newBooking;
+}
+
+
+// Function to check room availability for booking
+// Requests inside the calendar horizon are answered from the room's night bitmap; others use the stay index:
+// a stay [in, out) overlaps the request iff it starts before the requested check-out
+// and ends after the requested check-in, which also catches stays that enclose the whole request
+int isRoomAvailableForBooking(BookingStore *store, int roomId, int checkIn, int checkOut) {
+    RoomStays *roomStays = findRoomStays(store, roomId, false);
+    if (roomStays == NULL || roomStays->count == 0) {
+        return 1; // Nothing holds this room
+    }
+
+    if (checkIn < checkOut && checkIn >= store->calendarStart && checkOut <= store->calendarStart + CALENDAR_DAYS) {
+        return isCalendarRangeFree(roomStays, checkIn - store->calendarStart, checkOut - store->calendarStart);
+    }
+
+    // Binary search for the number of stays that start before the requested check-out
+    int low = 0, high = roomStays->count;
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        if (roomStays->stays[mid].checkIn < checkOut) {
+            low = mid + 1;
+        } else {
+            high = mid;
         }
-    } while (strcmp(checkInDate, checkOutDate) >= 0);
+    }
 
-    // Check if room is available for the specified duration
-    if (!isRoomAvailableForBooking(*head, roomId, checkInDate, checkOutDate)) {
-        printf("Room is not available for the specified duration.\n");
-        return; // Exit if the room is not available
+    // The latest check-out among those stays decides whether any of them reaches into the request
+    if (low > 0 && roomStays->maxCheckOut[low - 1] > checkIn) {
+        return 0; // Room is not available
     }
 
-    // Ask the user if they want to make a reservation
-    int choice;
-    printf("Room is available. Do you want to make a reservation? (1 for yes, 0 for no): ");
-    scanf("%d", &choice);
+    return 1; // Room is available
+}
 
-    if (choice != 1) {
-        printf("Reservation not made.\n");
-        return; // Exit if the user decides not to make a reservation
+
+// Function to list the rooms that are held for any night of [checkIn, checkOut), in room ID order
+// Sweeps every room's calendar in one pass instead of looking each room up separately
+// Returns the number of room IDs written to heldRooms, which must have room for store->roomStayCount entries
+int collectHeldRooms(BookingStore *store, int checkIn, int checkOut, int *heldRooms) {
+    int heldCount = 0;
+    bool inHorizon = checkIn < checkOut && checkIn >= store->calendarStart && checkOut <= store->calendarStart + CALENDAR_DAYS;
+
+    for (int i = 0; i < store->roomStayCount; i++) {
+        RoomStays *roomStays = &store->roomStays[i];
+        if (roomStays->count == 0) {
+            continue;
+        }
+        bool available = inHorizon ? isCalendarRangeFree(roomStays, checkIn - store->calendarStart, checkOut - store->calendarStart)
+                                   : isRoomAvailableForBooking(store, roomStays->roomId, checkIn, checkOut);
+        if (!available) {
+            heldRooms[heldCount++] = roomStays->roomId;
+        }
+    }
+    return heldCount;
+}
+
+
+// Function to check that none of the nights [from, to) of a room's calendar are held
+// from and to are offsets from the calendar start and must lie inside the horizon
+bool isCalendarRangeFree(const RoomStays *roomStays, int from, int to) {
+    int firstWord = from / 64;
+    int lastWord = (to - 1) / 64;
+
+    // OR the held nights of every word the range touches, masking the partial words at either end
+    unsigned long long held = 0;
+    for (int word = firstWord; word <= lastWord; word++) {
+        unsigned long long mask = ~0ULL;
+        if (word == firstWord) {
+            mask &= ~0ULL << (from % 64);
+        }
+        if (word == lastWord && to % 64 != 0) {
+            mask &= ~0ULL >> (64 - to % 64);
+        }
+        held |= roomStays->occupied[word] & mask;
+    }
+    return held == 0;
+}
+
+
+// Function to set or clear the nights [checkIn, checkOut) of a room's calendar
+// The part of the stay outside the horizon is ignored
+void markCalendarNights(RoomStays *roomStays, int calendarStart, int checkIn, int checkOut, bool held) {
+    int from = checkIn - calendarStart;
+    int to = checkOut - calendarStart;
+    if (from < 0) {
+        from = 0;
+    }
+    if (to > CALENDAR_DAYS) {
+        to = CALENDAR_DAYS;
+    }
+
+    for (int night = from; night < to; ) {
+        // Set or clear up to the end of the current word at once
+        int word = night / 64;
+        int end = (word + 1) * 64 < to ? (word + 1) * 64 : to;
+        unsigned long long mask = (end - night == 64 ? ~0ULL : ((1ULL << (end - night)) - 1)) << (night % 64);
+        if (held) {
+            roomStays->occupied[word] |= mask;
+        } else {
+            roomStays->occupied[word] &= ~mask;
+        }
+        night = end;
+    }
+}
+
+
+// Function to move the calendar horizon so it starts today, rebuilding every room's bitmap
+// Does nothing when the horizon already starts today
+void rollRoomCalendars(BookingStore *store) {
+    char currentDate[DATE_LENGTH];
+    getCurrentDate(currentDate, DATE_LENGTH);
+    int today = dateToDayNumber(currentDate);
+    if (today == store->calendarStart) {
+        return;
+    }
+
+    store->calendarStart = today;
+    for (int i = 0; i < store->roomStayCount; i++) {
+        RoomStays *roomStays = &store->roomStays[i];
+        memset(roomStays->occupied, 0, sizeof(roomStays->occupied));
+        for (int j = 0; j < roomStays->count; j++) {
+            markCalendarNights(roomStays, today, roomStays->stays[j].checkIn, roomStays->stays[j].checkOut, true);
+        }
+    }
+}
+
+
+// Function to find the stay index of a room, creating an empty one if requested
+RoomStays* findRoomStays(BookingStore *store, int roomId, bool create) {
+    // Binary search the rooms, which are kept sorted by ID
+    int low = 0, high = store->roomStayCount;
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        if (store->roomStays[mid].roomId < roomId) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    if (low < store->roomStayCount && store->roomStays[low].roomId == roomId) {
+        return &store->roomStays[low];
+    }
+    if (!create) {
+        return NULL;
+    }
+
+    // Grow the room array if needed
+    if (store->roomStayCount == store->roomStayCapacity) {
+        int newCapacity = store->roomStayCapacity == 0 ? 16 : store->roomStayCapacity * 2;
+        RoomStays *grown = realloc(store->roomStays, newCapacity * sizeof(RoomStays));
+        if (grown == NULL) {
+            perror("Failed to allocate memory for room stay index");
+            return NULL;
+        }
+        store->roomStays = grown;
+        store->roomStayCapacity = newCapacity;
+    }
+
+    // Insert the new room at its sorted position
+    memmove(&store->roomStays[low + 1], &store->roomStays[low], (store->roomStayCount - low) * sizeof(RoomStays));
+    memset(&store->roomStays[low], 0, sizeof(RoomStays));
+    store->roomStays[low].roomId = roomId;
+    store->roomStayCount++;
+    return &store->roomStays[low];
+}
+
+
+// Function to recompute the running maximum check-out from a position to the end of a room's stays
+void updateMaxCheckOut(RoomStays *roomStays, int from) {
+    for (int i = from; i < roomStays->count; i++) {
+        int previous = i > 0 ? roomStays->maxCheckOut[i - 1] : roomStays->stays[i].checkOut;
+        roomStays->maxCheckOut[i] = roomStays->stays[i].checkOut > previous ? roomStays->stays[i].checkOut : previous;
+    }
+}
+
+
+// Function to add a booking's stay to the index of its room
+// Returns false if the index could not grow
+bool addRoomStay(BookingStore *store, const Booking *booking) {
+    Stay stay = { booking->checkInDate, booking->checkOutDate, booking->id };
+    return insertRoomStay(store, booking->roomId, stay);
+}
+
+
+// Function to make sure the index of a room has space for one more stay
+// Returns the room's stays, or NULL if they could not grow; the index is then unchanged
+RoomStays* reserveRoomStay(BookingStore *store, int roomId) {
+    RoomStays *roomStays = findRoomStays(store, roomId, true);
+    if (roomStays == NULL || roomStays->count < roomStays->capacity) {
+        return roomStays;
+    }
+
+    // Grow both arrays before recording the new capacity; if the second fails, the first is merely
+    // longer than capacity says, and the next attempt reallocates it to the same size
+    int newCapacity = roomStays->capacity == 0 ? 4 : roomStays->capacity * 2;
+    Stay *grownStays = realloc(roomStays->stays, newCapacity * sizeof(Stay));
+    if (grownStays == NULL) {
+        perror("Failed to allocate memory for room stay index");
+        return NULL;
+    }
+    roomStays->stays = grownStays;
+    int *grownMax = realloc(roomStays->maxCheckOut, newCapacity * sizeof(int));
+    if (grownMax == NULL) {
+        perror("Failed to allocate memory for room stay index");
+        return NULL;
+    }
+    roomStays->maxCheckOut = grownMax;
+    roomStays->capacity = newCapacity;
+    return roomStays;
+}
+
+
+// Function to add a stay (of a booking or a hold) to the index of its room
+// Returns false if the index could not grow, in which case the stay is not added
+bool insertRoomStay(BookingStore *store, int roomId, Stay stay) {
+    RoomStays *roomStays = reserveRoomStay(store, roomId);
+    if (roomStays == NULL) {
+        return false;
+    }
+
+    // Keep the stays sorted by check-in day
+    int position = roomStays->count;
+    while (position > 0 && roomStays->stays[position - 1].checkIn > stay.checkIn) {
+        position--;
+    }
+    memmove(&roomStays->stays[position + 1], &roomStays->stays[position], (roomStays->count - position) * sizeof(Stay));
+    roomStays->stays[position] = stay;
+    roomStays->count++;
+    updateMaxCheckOut(roomStays, position);
+    markCalendarNights(roomStays, store->calendarStart, stay.checkIn, stay.checkOut, true);
+    return true;
+}
+
+
+// Function to remove a booking's stay from the index of its room
+void removeRoomStay(BookingStore *store, const Booking *booking) {
+    deleteRoomStay(store, booking->roomId, booking->id);
+}
+
+
+// Function to remove the stay of a booking or hold from the index of a room, if it is there
+void deleteRoomStay(BookingStore *store, int roomId, long long bookingId) {
+    RoomStays *roomStays = findRoomStays(store, roomId, false);
+    if (roomStays == NULL) {
+        return;
+    }
+
+    for (int i = 0; i < roomStays->count; i++) {
+        if (roomStays->stays[i].bookingId == bookingId) {
+            Stay removed = roomStays->stays[i];
+            memmove(&roomStays->stays[i], &roomStays->stays[i + 1], (roomStays->count - i - 1) * sizeof(Stay));
+            roomStays->count--;
+            updateMaxCheckOut(roomStays, i);
+
+            // Free the stay's nights, then re-mark those still held by stays that overlap it
+            markCalendarNights(roomStays, store->calendarStart, removed.checkIn, removed.checkOut, false);
+            for (int j = 0; j < roomStays->count && roomStays->stays[j].checkIn < removed.checkOut; j++) {
+                if (roomStays->stays[j].checkOut > removed.checkIn) {
+                    markCalendarNights(roomStays, store->calendarStart, roomStays->stays[j].checkIn, roomStays->stays[j].checkOut, true);
+                }
+            }
+            return;
+        }
+    }
+}
+
+
+// Function to change a booking's status in memory, keeping the room stay index up to date
+// The caller is responsible for journaling the change
+void applyBookingStatus(BookingStore *store, Booking *booking, BookingStatus status) {
+    bool heldRoom = booking->status == RESERVED || booking->status == CHECKED_IN;
+    bool holdsRoom = status == RESERVED || status == CHECKED_IN;
+
+    booking->status = (unsigned char)status;
+
+    if (heldRoom && !holdsRoom) {
+        removeRoomStay(store, booking); // Cancelled or checked out, the room is free again
+    } else if (!heldRoom && holdsRoom && !addRoomStay(store, booking)) {
+        store->staysIncomplete = true;
+    }
+}
+
+
+// Function to display booking details
+void displayBookingIdDetails(BookingStore *store, const Booking *booking) {
+    char bookingDate[DATE_LENGTH], checkInDate[DATE_LENGTH], checkOutDate[DATE_LENGTH];
+    dayNumberToDate(booking->bookingDate, bookingDate, DATE_LENGTH);
+    dayNumberToDate(booking->checkInDate, checkInDate, DATE_LENGTH);
+    dayNumberToDate(booking->checkOutDate, checkOutDate, DATE_LENGTH);
+
+    printf("\n------------ Booking Details ------------");
+    printf("\nBooking ID: %lld\n", booking->id);
+    printf("User ID: %s\n", internedString(&store->userIds, booking->userHandle));
+    printf("Room ID: %d\n", booking->roomId);
+    printf("Status: %s\n", bookingStatusName(booking->status));
+    printf("Booking Date: %s\n", bookingDate);
+    printf("Check-In Date: %s\n", checkInDate);
+    printf("Check-Out Date: %s\n", checkOutDate);
+    printf("-----------------------------------------\n");
+}
+
+
+// Function to write the ID, user, room, status and dates of a booking as one text line
+// This is the record format of bookings.txt without its order number, and of the booking lines of daemon replies
+void writeBookingRecord(FILE *file, BookingStore *store, const Booking *booking) {
+    char bookingDate[DATE_LENGTH], checkInDate[DATE_LENGTH], checkOutDate[DATE_LENGTH];
+    dayNumberToDate(booking->bookingDate, bookingDate, DATE_LENGTH);
+    dayNumberToDate(booking->checkInDate, checkInDate, DATE_LENGTH);
+    dayNumberToDate(booking->checkOutDate, checkOutDate, DATE_LENGTH);
+    fprintf(file, "%lld, %s, %d, %s, %s, %s, %s\n",
+            booking->id, internedString(&store->userIds, booking->userHandle), booking->roomId,
+            bookingStatusName(booking->status), bookingDate, checkInDate, checkOutDate);
+}
+
+
+// Function to read the next booking line written by writeBookingRecord
+bool readBookingRecord(BookingStore *store, RecordReader *reader, Booking *booking) {
+    char *fields[BOOKING_FIELDS];
+    if (nextRecord(reader, fields, BOOKING_FIELDS - 1) != BOOKING_FIELDS - 1 || !parseBookingFields(store, fields, booking)) {
+        return false;
+    }
+    return true;
+}
+
+
+// Function to display every booking line left in a daemon reply
+// Returns the number of bookings displayed
+int displayBookingRecords(BookingStore *store, RecordReader *reader) {
+    int displayed = 0;
+    Booking booking;
+    while (readBookingRecord(store, reader, &booking)) {
+        displayBookingIdDetails(store, &booking);
+        displayed++;
+    }
+    closeRecordReader(reader);
+    return displayed;
+}
+
+
+// Function to free memory allocated for the booking store
+void freeBookings(BookingStore *store) {
+    // Release the arena chunks
+    int chunkCount = (store->count + BOOKING_CHUNK_SIZE - 1) / BOOKING_CHUNK_SIZE;
+    for (int i = store->mappedChunks; i < chunkCount; i++) {
+        free(store->chunks[i]);
+    }
+    free(store->chunks);
+
+    // Free the room stay index
+    for (int i = 0; i < store->roomStayCount; i++) {
+        free(store->roomStays[i].stays);
+        free(store->roomStays[i].maxCheckOut);
+    }
+    free(store->roomStays);
+    if (!store->idIndex.mapped) {
+        free(store->idIndex.slots); // The index only holds handles into the arena
+    }
+    free(store->checkInDeadlines.items);
+    free(store->holds.items);
+    for (int i = 0; i < store->userBookingCapacity; i++) {
+        free(store->userBookings[i].handles);
+    }
+    free(store->userBookings);
+    for (int field = 0; field < BOOKING_DATE_FIELD_COUNT; field++) {
+        free(store->dateIndexes[field].keys);
+    }
+    freeStringPool(&store->userIds);
+
+    memset(store, 0, sizeof(BookingStore));
+}
+
+
+// Function to check that a room is free for a stay
+// The caller keeps the room calendars rolled to today
+BookingResult checkRoomFree(BookingStore *store, int roomId, int checkIn, int checkOut) {
+    if (store->staysIncomplete) {
+        return BOOKING_FAILED; // A stay that is missing from the index could make a taken room look free
+    }
+    return isRoomAvailableForBooking(store, roomId, checkIn, checkOut) ? BOOKING_DONE : BOOKING_ROOM_TAKEN;
+}
+
+
+// Function to add a Reserved booking booked today to the store and copy it into booking
+// The room must already have been checked, and the caller journals the new booking
+BookingResult insertReservation(BookingStore *store, const char *userId, int roomId, int checkIn, int checkOut, Booking *booking) {
+    // Generate unique ID for the new booking
+    long long uniqueId = generateUniqueId(store);
+    if (uniqueId == -1) {
+        return BOOKING_NO_ID;
+    }
+
+    // Add the new booking to the store, booked today
+    char currentDate[DATE_LENGTH], checkInDate[DATE_LENGTH], checkOutDate[DATE_LENGTH];
+    getCurrentDate(currentDate, DATE_LENGTH);
+    dayNumberToDate(checkIn, checkInDate, DATE_LENGTH);
+    dayNumberToDate(checkOut, checkOutDate, DATE_LENGTH);
+    Booking *newBooking = addBookingNode(store, uniqueId, userId, roomId, currentDate, checkInDate, checkOutDate);
+    if (newBooking == NULL) {
+        return BOOKING_FAILED;
+    }
+    *booking = *newBooking;
+    return BOOKING_DONE;
+}
+
+
+// Function to reserve a room for a customer and copy the new booking into booking
+// The room is checked again here, since another terminal may have taken it while the customer was deciding
+BookingResult reserveRoom(BookingStore *store, const char *userId, int roomId, int checkIn, int checkOut, Booking *booking) {
+    rollRoomCalendars(store);
+    BookingResult result = checkRoomFree(store, roomId, checkIn, checkOut);
+    if (result != BOOKING_DONE) {
+        return result;
+    }
+
+    result = insertReservation(store, userId, roomId, checkIn, checkOut, booking);
+    if (result == BOOKING_DONE) {
+        journalAddBooking(store, booking); // Record the new booking in the journal
+    }
+    return result;
+}
+
+
+// Function to cancel (CANCELLED), check in (CHECKED_IN) or check out (CHECKED_OUT) a booking of a customer in memory
+// Cancelling and checking in need a Reserved booking, and checking in only works on its check-in date;
+// checking out needs a Checked-In booking. The caller journals the change
+BookingResult applyBookingChange(BookingStore *store, const char *userId, long long bookingId, BookingStatus status) {
+    // Look up the booking by its ID
+    Booking *current = findBookingById(store, bookingId);
+    if (current == NULL) {
+        return BOOKING_NOT_FOUND;
+    }
+
+    // Check if the status allows the change
+    if (status == CHECKED_IN && current->status == CHECKED_IN) {
+        return BOOKING_ALREADY_CHECKED_IN;
+    }
+    if (current->status != (status == CHECKED_OUT ? CHECKED_IN : RESERVED)) {
+        return BOOKING_WRONG_STATUS;
+    }
+
+    // Check if the user ID matches the one associated with the booking
+    if (current->userHandle != findInternedString(&store->userIds, userId)) {
+        return BOOKING_WRONG_USER;
+    }
+
+    // Check if the check-in date matches the current date
+    if (status == CHECKED_IN) {
+        char currentDate[DATE_LENGTH];
+        getCurrentDate(currentDate, DATE_LENGTH);
+        if (current->checkInDate != dateToDayNumber(currentDate)) {
+            return BOOKING_WRONG_DATE;
+        }
+    }
+
+    applyBookingStatus(store, current, status);
+    return BOOKING_DONE;
+}
+
+
+// Function to cancel, check in or check out a booking of a customer and journal the change
+BookingResult changeBooking(BookingStore *store, const char *userId, long long bookingId, BookingStatus status) {
+    BookingResult result = applyBookingChange(store, userId, bookingId, status);
+    if (result == BOOKING_DONE) {
+        journalUpdateStatus(store, bookingId, status); // Record the change in the journal
+    }
+    return result;
+}
+
+
+// Function to check room availability and make a reservation
+// With remote set the booking is made by the daemon, otherwise in this terminal's own store
+void makeReservation(BookingStore *store, RoomStore *rooms, bool remote, const char* userId) {
+
+    int roomId;
+    char checkInDate[DATE_LENGTH], checkOutDate[DATE_LENGTH];
+
+    // Check if room is active
+    roomId = checkRoomStatus(rooms);
+    if (roomId == -1) {
+        return; // Exit if the room is not active
+    }
+
+    // Get current date
+    char currentDate[DATE_LENGTH]; // Assuming YYYY-MM-DD format
+    getCurrentDate(currentDate, DATE_LENGTH); 
+
+    // Get valid check-in date (must be current date or later)
+    getValidDate(checkInDate, "Enter check-in date (YYYY-MM-DD): ", 0, currentDate);
+    
+    // Get valid check-out date (must be later than check-in date)
+    do {
+        getValidDate(checkOutDate, "Enter check-out date (YYYY-MM-DD): ", 0, checkInDate);
+
+        // Check if check-out date is the same as or earlier than check-in date
+        if (strcmp(checkInDate, checkOutDate) >= 0) {
+            printf("Check-out date must be later than check-in date. Please enter again.\n");
+        }
+    } while (strcmp(checkInDate, checkOutDate) >= 0);
+
+    // Check if room is available for the specified duration, and hold it while the customer decides
+    int checkIn = dateToDayNumber(checkInDate);
+    int checkOut = dateToDayNumber(checkOutDate);
+    RoomHold hold = { 0, roomId, checkIn, checkOut, 0 };
+    BookingResult result;
+    if (remote) {
+        RecordReader reply;
+        result = daemonRequest(&reply, "HOLD, %d, %s, %s", roomId, checkInDate, checkOutDate);
+        char *fields[2];
+        if (result == BOOKING_DONE && (nextRecord(&reply, fields, 1) != 1 || !parseLongLongField(fields[0], &hold.id))) {
+            result = BOOKING_FAILED;
+        }
+        closeRecordReader(&reply);
+    } else {
+        rollRoomCalendars(store); // Make sure the calendar horizon starts today
+        expireHolds(store); // Drop the heap entries of earlier holds, which only the daemon's maintenance would otherwise pop
+        result = placeHold(store, roomId, checkIn, checkOut, &hold);
+    }
+    if (result == BOOKING_UNREACHABLE) {
+        return; // Already reported
+    }
+    if (result != BOOKING_DONE) {
+        printf("Room is not available for the specified duration.\n");
+        return; // Exit if the room is not available
+    }
+
+    // Ask the user if they want to make a reservation
+    int choice;
+    printf("Room is available and held for you for %d seconds. Do you want to make a reservation? (1 for yes, 0 for no): ", RESERVATION_HOLD_SECONDS);
+    scanf("%d", &choice);
+
+    if (choice != 1) {
+        // Let other customers have the room straight away instead of when the hold expires
+        if (remote) {
+            daemonRequest(NULL, "RELEASE, %d, %lld", roomId, hold.id);
+        } else {
+            releaseHold(store, &hold);
+        }
+        printf("Reservation not made.\n");
+        return; // Exit if the user decides not to make a reservation
+    }
+
+    // Turn the hold into a booking; if the hold expired meanwhile the room is checked again and may have been taken
+    Booking booking;
+    if (remote) {
+        RecordReader reply;
+        result = daemonRequest(&reply, "RESERVE, %s, %d, %s, %s, %lld", userId, roomId, checkInDate, checkOutDate, hold.id);
+        if (result == BOOKING_DONE && !readBookingRecord(store, &reply, &booking)) {
+            result = BOOKING_FAILED;
+        }
+        closeRecordReader(&reply);
+    } else {
+        releaseHold(store, &hold);
+        result = reserveRoom(store, userId, roomId, checkIn, checkOut, &booking);
+    }
+
+    switch (result) {
+        case BOOKING_DONE:
+            // Display booking details
+            displayBookingIdDetails(store, &booking);
+            printf("Reservation successfully made with booking ID: %lld\n", booking.id);
+            break;
+        case BOOKING_ROOM_TAKEN:
+            printf("Room is not available for the specified duration.\n");
+            break;
+        case BOOKING_NO_ID:
+            printf("Error: Unable to generate a unique ID for the reservation.\n");
+            break;
+        case BOOKING_UNREACHABLE:
+            break; // Already reported
+        default:
+            printf("Error: Unable to store the reservation.\n");
+    }
+}
+
+
+// Function to cancel a reservation
+void cancelReservation(BookingStore *store, bool remote, const char *userId) {
+    // If no bookings or error loading bookings, return
+    if (!remote && store->count == 0) {
+        printf("No bookings available.\n");
+        return;
+    }
+
+    // Get input for booking ID
+    long long bookingId;
+    printf("Enter booking ID to cancel: ");
+    scanf("%lld", &bookingId);
+    getchar(); // Consume newline character
+
+    BookingResult result;
+    if (remote) {
+        result = daemonRequest(NULL, "CANCEL, %s, %lld", userId, bookingId);
+    } else {
+        result = changeBooking(store, userId, bookingId, CANCELLED);
+    }
+
+    switch (result) {
+        case BOOKING_DONE:
+            printf("Reservation cancelled successfully for booking ID: %lld\n", bookingId);
+            break;
+        case BOOKING_NOT_FOUND:
+            printf("Booking ID: %lld not found.\n", bookingId);
+            break;
+        case BOOKING_UNREACHABLE:
+            break; // Already reported
+        default:
+            printf("Cancellation failed. Either the booking ID or user ID is incorrect, or the booking is not in 'Reserved' status.\n");
+    }
+}
+
+
+// Function to cancel a reservation based on check-in date less than current date
+// Called at startup and from the menu loops so long-running sessions keep cancelling on time
+void autoCancelReservations(BookingStore *store) {
+    long long *cancelledIds = NULL;
+    int cancelledCount = takeOverdueReservations(store, &cancelledIds);
+
+    // Persist the whole batch with one journal write
+    if (cancelledCount > 0) {
+        journalStatusChanges(store, cancelledIds, cancelledCount, CANCELLED);
+    }
+    free(cancelledIds);
+}
+
+
+// Function to cancel every Reserved booking whose check-in date has passed, without journaling the changes
+// Pops the overdue bookings off the check-in deadline heap, so a run with nothing overdue costs O(1).
+// Returns the number cancelled; their IDs are left in *cancelledIds, which the caller frees
+int takeOverdueReservations(BookingStore *store, long long **cancelledIds) {
+    KeyedHeap *heap = &store->checkInDeadlines;
+    *cancelledIds = NULL;
+    if (heap->count == 0) {
+        return 0;
+    }
+
+    char currentDate[DATE_LENGTH];
+    getCurrentDate(currentDate, DATE_LENGTH);
+    int today = dateToDayNumber(currentDate);
+
+    int cancelledCount = 0, cancelledCapacity = 0;
+    while (heap->count > 0 && ((CheckInDeadline*)heap->items)->checkIn < today) {
+        // Entries stay behind when a booking is checked in or cancelled first; skip those
+        Booking *current = getBooking(store, ((CheckInDeadline*)heap->items)->handle);
+        if (current->status != RESERVED) {
+            popCheckInDeadline(store);
+            continue;
+        }
+
+        if (!growArray((void**)cancelledIds, cancelledCount, &cancelledCapacity, sizeof(long long))) {
+            break; // Leave the rest for the next run
+        }
+        popCheckInDeadline(store);
+
+        // Update status to "Cancelled"
+        applyBookingStatus(store, current, CANCELLED);
+        (*cancelledIds)[cancelledCount++] = current->id;
+    }
+    return cancelledCount;
+}
+
+
+// Function to add a Reserved booking to the check-in deadline heap
+void pushCheckInDeadline(BookingStore *store, int handle) {
+    CheckInDeadline entry = { getBooking(store, handle)->checkInDate, handle };
+    pushKeyedHeap(&store->checkInDeadlines, &entry, sizeof(CheckInDeadline), offsetof(CheckInDeadline, checkIn));
+}
+
+
+// Function to remove the earliest check-in from the deadline heap
+void popCheckInDeadline(BookingStore *store) {
+    popKeyedHeap(&store->checkInDeadlines, sizeof(CheckInDeadline), offsetof(CheckInDeadline, checkIn));
+}
+
+
+// Function to hold a room for a stay while a customer decides whether to reserve it
+// The hold counts as a stay of the room, so availability checks of every terminal see the room as taken
+BookingResult placeHold(BookingStore *store, int roomId, int checkIn, int checkOut, RoomHold *hold) {
+    BookingResult result = checkRoomFree(store, roomId, checkIn, checkOut);
+    if (result != BOOKING_DONE) {
+        return result;
+    }
+    if (!growArray(&store->holds.items, store->holds.count, &store->holds.capacity, sizeof(RoomHold))) {
+        return BOOKING_FAILED;
+    }
+
+    hold->id = --store->lastHoldId;
+    hold->roomId = roomId;
+    hold->checkIn = checkIn;
+    hold->checkOut = checkOut;
+    hold->expires = (long long)time(NULL) + RESERVATION_HOLD_SECONDS;
+
+    // A hold that is not in the stay index would not keep anyone out of the room
+    Stay stay = { checkIn, checkOut, hold->id };
+    if (!insertRoomStay(store, roomId, stay)) {
+        return BOOKING_FAILED;
+    }
+    pushHold(store, hold);
+    return BOOKING_DONE;
+}
+
+
+// Function to give up a hold before it expires; nothing happens if it already expired
+// Its heap entry stays behind and is skipped when it comes up for expiry
+void releaseHold(BookingStore *store, const RoomHold *hold) {
+    deleteRoomStay(store, hold->roomId, hold->id);
+}
+
+
+// Function to release every hold whose time is up
+// Pops the expired holds off the hold heap, so a run with nothing expired costs O(1)
+void expireHolds(BookingStore *store) {
+    KeyedHeap *heap = &store->holds;
+    long long now = (long long)time(NULL);
+    while (heap->count > 0 && ((RoomHold*)heap->items)->expires <= now) {
+        releaseHold(store, heap->items);
+        popHold(store);
+    }
+}
+
+
+// Function to add a hold to the expiry heap; placeHold makes room first, so this cannot fail once the stay is in
+void pushHold(BookingStore *store, const RoomHold *hold) {
+    pushKeyedHeap(&store->holds, hold, sizeof(RoomHold), offsetof(RoomHold, expires));
+}
+
+
+// Function to remove the earliest expiry from the hold heap
+void popHold(BookingStore *store) {
+    popKeyedHeap(&store->holds, sizeof(RoomHold), offsetof(RoomHold, expires));
+}
+
+
+// Function to perform checking for a booking
+void checkin(BookingStore *store, bool remote) {
+    // If no bookings or error loading bookings, return
+    if (!remote && store->count == 0) {
+        printf("No bookings available.\n");
+        return;
+    }
+
+    // Get input for booking ID and user ID
+    long long bookingId;
+    char userId[ID_LENGTH];
+    printf("Enter booking ID to check in: ");
+    scanf("%lld", &bookingId);
+    getchar(); // Consume newline character
+    printf("Enter user ID: ");
+    fgets(userId, ID_LENGTH, stdin);
+    userId[strcspn(userId, "\n")] = '\0'; // Remove newline character
+
+    BookingResult result;
+    if (remote) {
+        result = daemonRequest(NULL, "CHECKIN, %s, %lld", userId, bookingId);
+    } else {
+        result = changeBooking(store, userId, bookingId, CHECKED_IN);
+    }
+
+    switch (result) {
+        case BOOKING_DONE:
+            printf("Check-in successful for booking ID: %lld\n", bookingId);
+            break;
+        case BOOKING_NOT_FOUND:
+            printf("Booking ID: %lld not found.\n", bookingId);
+            break;
+        case BOOKING_WRONG_DATE:
+            printf("Check-in date mismatch for booking ID: %lld. Cannot check-in.\n", bookingId);
+            break;
+        case BOOKING_WRONG_USER:
+            printf("Booking ID: %lld cannot be checked in. Reserved by another user.\n", bookingId);
+            break;
+        case BOOKING_ALREADY_CHECKED_IN:
+            printf("Booking ID: %lld is already checked in.\n", bookingId);
+            break;
+        case BOOKING_UNREACHABLE:
+            break; // Already reported
+        default:
+            printf("Booking ID: %lld cannot be checked in. Status must be 'Reserved'.\n", bookingId);
+    }
+}
+
+
+// Function to perform checkout for a booking
+void checkout(BookingStore *store, bool remote) {
+    // If no bookings or error loading bookings, return
+    if (!remote && store->count == 0) {
+        printf("No bookings available.\n");
+        return;
+    }
+
+    // Get input for booking ID and user ID
+    long long bookingId;
+    char userId[ID_LENGTH];
+    printf("Enter booking ID to check out: ");
+    scanf("%lld", &bookingId);
+    getchar(); // Consume newline character
+    printf("Enter user ID: ");
+    fgets(userId, sizeof(userId), stdin);
+    userId[strcspn(userId, "\n")] = '\0'; // Remove newline character
+
+    BookingResult result;
+    if (remote) {
+        result = daemonRequest(NULL, "CHECKOUT, %s, %lld", userId, bookingId);
+    } else {
+        result = changeBooking(store, userId, bookingId, CHECKED_OUT);
+    }
+
+    switch (result) {
+        case BOOKING_DONE:
+            printf("Checkout successful for booking ID: %lld\n", bookingId);
+            break;
+        case BOOKING_NOT_FOUND:
+            printf("Booking ID: %lld not found.\n", bookingId);
+            break;
+        case BOOKING_UNREACHABLE:
+            break; // Already reported
+        default:
+            printf("Checkout failed. Either the booking ID or user ID is incorrect, or the booking is not in 'Checked-In' status.\n");
+    }
+}
+
+
+// Function to view booking history within a specified date range
+void viewBookingHistory(BookingStore *store, bool remote) {
+    // Check if there are any bookings
+    if (!remote && store->count == 0) {
+        printf("No bookings available.\n");
+        return;
+    }
+
+    // Ask which date of the bookings to filter on
+    int field;
+    do {
+        printf("Filter by (1 for booking date, 2 for check-in date, 3 for check-out date): ");
+        if (scanf("%d", &field) != 1) {
+            field = 0;
+        }
+        clearInputBuffer();
+        if (field < 1 || field > 3) {
+            printf("Invalid choice. Please enter 1, 2 or 3.\n");
+        }
+    } while (field < 1 || field > 3);
+
+    // Get start and end dates from the user
+    char startDate[DATE_LENGTH], endDate[DATE_LENGTH];
+    // Prompt user to enter start date and validate
+    getValidDate(startDate, "Enter start date (YYYY-MM-DD): ", 1, NULL); // allowPastDate is set to 1 (true)
+
+    // Prompt user to enter end date and validate, ensuring it's later than start date
+    do {
+        getValidDate(endDate, "Enter end date (YYYY-MM-DD): ", 1, NULL); // allowPastDate is set to 1 (true)
+
+        // Check if end date is later than start date
+        if (strcmp(startDate, endDate) >= 0) {
+            printf("End date must be later than start date. Please enter again.\n");
+        }
+    } while (strcmp(startDate, endDate) >= 0);
+
+    // Display booking history within the specified date range
+    printf("Booking History within Date Range (%s - %s):\n", startDate, endDate);
+    printf("===========================================\n");
+    if (remote) {
+        RecordReader reply;
+        if (daemonRequest(&reply, "FIND, %d, %s, %s", field, startDate, endDate) == BOOKING_DONE) {
+            displayBookingRecords(store, &reply);
+        }
+        return;
+    }
+    int start = dateToDayNumber(startDate);
+    int end = dateToDayNumber(endDate);
+    if (!store->dateIndexesBuilt && !buildDateIndexes(store)) {
+        return;
+    }
+
+    // Jump to the first booking on or after the start date and stream until the end date
+    const DateIndex *index = &store->dateIndexes[field - 1];
+    for (int i = findDateIndexPosition(index, start); i < index->count && index->keys[i].day <= end; i++) {
+        displayBookingIdDetails(store, getBooking(store, index->keys[i].handle));
+    }
+}
+
+
+// Function to check current bookings for a specific user
+void checkCurrentBooking(BookingStore *store, bool remote, const char* userId) {
+    int found = 0; // Flag to indicate if any matching booking is found
+
+    // Check if there are any bookings
+    if (!remote && store->count == 0) {
+        printf("No bookings available.\n");
+        return;
+    }
+
+    // Display current bookings for the specified user
+    printf("Current Bookings for User ID: %s\n", userId);
+    printf("================================\n");
+    if (remote) {
+        RecordReader reply;
+        if (daemonRequest(&reply, "CURRENT, %s", userId) != BOOKING_DONE) {
+            return;
+        }
+        found = displayBookingRecords(store, &reply) > 0;
+    } else {
+        // Only walk this customer's own bookings
+        int userHandle = findInternedString(&store->userIds, userId);
+        int bookingCount = userHandle >= 0 && userHandle < store->userBookingCapacity ? store->userBookings[userHandle].count : 0;
+        for (int i = 0; i < bookingCount; i++) {
+            Booking *current = getBooking(store, store->userBookings[userHandle].handles[i]);
+            // Check if the booking is reserved or checked-in
+            if (current->status == RESERVED || current->status == CHECKED_IN) {
+                displayBookingIdDetails(store, current);
+                found = 1; // Set the flag to indicate at least one matching booking is found
+            }
+        }
+    }
+    
+    // If no matching bookings are found, display a message
+    if (!found) {
+        printf("No current bookings available for your user ID.\n");
+    }
+}
+
+
+// Function to check booking history for a specific user
+void checkBookingHistory(BookingStore *store, bool remote, const char* userId) {
+    int found = 0; // Flag to indicate if any matching booking is found
+
+    // Check if there are any bookings
+    if (!remote && store->count == 0) {
+        printf("No bookings available.\n");
+        return;
+    }
+
+    // Display booking history for the specified user
+    printf("Booking History for User ID: %s\n", userId);
+    printf("================================\n");
+    if (remote) {
+        RecordReader reply;
+        if (daemonRequest(&reply, "HISTORY, %s", userId) != BOOKING_DONE) {
+            return;
+        }
+        found = displayBookingRecords(store, &reply) > 0;
+    } else {
+        // Only walk this customer's own bookings
+        int userHandle = findInternedString(&store->userIds, userId);
+        int bookingCount = userHandle >= 0 && userHandle < store->userBookingCapacity ? store->userBookings[userHandle].count : 0;
+        for (int i = 0; i < bookingCount; i++) {
+            Booking *current = getBooking(store, store->userBookings[userHandle].handles[i]);
+            // Check if the booking is either cancelled or checked-out
+            if (current->status == CANCELLED || current->status == CHECKED_OUT) {
+                displayBookingIdDetails(store, current);
+                found = 1; // Set the flag to indicate at least one matching booking is found
+            }
+        }
+    }
+
+    // If no matching bookings are found, display a message
+    if (!found) {
+        printf("You do not have any booking history at our hotel.\n");
+    }
+}
+
+
+// Function to view room availability for a specific duration
+void checkRoomAvailabilities(BookingStore *store, RoomStore *rooms, bool remote) {
+    char startDate[DATE_LENGTH], endDate[DATE_LENGTH], currentDate[DATE_LENGTH];
+
+    // Get valid dates for the specified duration
+    getCurrentDate(currentDate, DATE_LENGTH);
+    
+    // Get valid start date (must be current date or later)
+    getValidDate(startDate, "Enter start date (YYYY-MM-DD): ", 0, currentDate); 
+    
+    // Get valid end date (must be later than start date)
+    do {
+        getValidDate(endDate, "Enter end date (YYYY-MM-DD): ", 0, startDate);
+
+        // Check if end date is the same as or earlier than start date
+        if (strcmp(startDate, endDate) >= 0) {
+            printf("End date must be later than start date. Please enter again.\n");
+        }
+    } while (strcmp(startDate, endDate) >= 0);
+      
+    // Load existing rooms from file
+    loadRooms(rooms);
+
+    // Iterate over each room and check availability for the specified duration
+    printf("\nRoom Availabilities for the Duration %s to %s:\n", startDate, endDate);
+    printf("--------------------------------------------------------------\n");
+    int anyRoomAvailable = 0;
+    int start = dateToDayNumber(startDate);
+    int end = dateToDayNumber(endDate);
+
+    // Find every held room in one sweep of the calendars, or ask the daemon for its list
+    int *heldRooms = NULL;
+    int heldCount = 0, heldCapacity = 0;
+    if (remote) {
+        RecordReader reply;
+        if (daemonRequest(&reply, "HELD, %s, %s", startDate, endDate) != BOOKING_DONE) {
+            return;
+        }
+        char *fields[2];
+        int heldRoom;
+        while (nextRecord(&reply, fields, 1) == 1 && parseIntField(fields[0], &heldRoom) &&
+               growArray((void**)&heldRooms, heldCount, &heldCapacity, sizeof(int))) {
+            heldRooms[heldCount++] = heldRoom; // The daemon sends them sorted
+        }
+        closeRecordReader(&reply);
+    } else {
+        // Make sure the calendar horizon starts today
+        rollRoomCalendars(store);
+        heldRooms = malloc((store->roomStayCount + 1) * sizeof(int));
+        if (heldRooms == NULL) {
+            perror("Failed to allocate memory for room availability");
+            return;
+        }
+        heldCount = collectHeldRooms(store, start, end, heldRooms);
+    }
+
+    for (int i = 0; i < rooms->count; i++) {
+        if (rooms->items[i].active == 1 && !rooms->items[i].deleted && !containsRoomId(heldRooms, heldCount, rooms->items[i].id)) {
+            displayRoom(rooms, rooms->items[i].id);
+            anyRoomAvailable++;
+        }
+    }
+    printf("\n%d available room.\n", anyRoomAvailable);
+    free(heldRooms);
+}
+
+
+// Function to binary search a sorted list of room IDs
+bool containsRoomId(const int *roomIds, int count, int roomId) {
+    int low = 0, high = count;
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        if (roomIds[mid] < roomId) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low < count && roomIds[low] == roomId;
+}
+
+
+// FUNCTION USER LOGIN TRACKING 
+
+// Function to load events from a file
+void loadEvents(EventStore *events) {
+    RecordReader reader;
+    // Read the whole event file
+    if (!openRecordReader(&reader, EVENTS_FILE)) {
+        printf("Error opening events file for reading.\n");
+        events->count = 0;
+        return; // No event file found, start with empty event list
+    }
+
+    events->count = 0; // Initialize event count
+    events->inTimeOrder = true;
+    char *fields[EVENT_FIELDS + 1];
+    int fieldCount;
+    // Read event data from the file
+    while ((fieldCount = nextRecord(&reader, fields, EVENT_FIELDS)) != -1) {
+        LoginLogoutEvent event;
+        if (fieldCount != EVENT_FIELDS || !parseIntField(fields[0], &event.orderNum) ||
+            !copyField(event.userId, fields[1], ID_LENGTH) || !copyField(event.eventType, fields[2], EVENT_TYPE_LENGTH) ||
+            (event.timestamp = parseTimestamp(fields[3])) == -1) {
+            reportMalformedRecord(&reader, "expected order number, user, event type and timestamp");
+            continue;
+        }
+
+        if (!growMappedArray((void**)&events->items, events->count, &events->capacity, sizeof(LoginLogoutEvent), &events->itemsMapped)) {
+            break; // Keep the events loaded so far
+        }
+        events->items[events->count] = event;
+        indexEvent(events, events->count);
+        events->count++;
+    }
+
+    closeRecordReader(&reader);
+}
+
+
+// Function to log an event 
+// The event is added to the in-memory store and queued for the writer thread, so logging never waits for the disk
+void logEvent(EventStore *events, const char *userId, const char *eventType) {
+    if (!growMappedArray((void**)&events->items, events->count, &events->capacity, sizeof(LoginLogoutEvent), &events->itemsMapped)) {
+        printf("Error: Unable to log the event.\n");
+        return;
+    }
+
+    // Log the event
+    events->items[events->count].orderNum = events->count + 1; // Assign a unique order number
+    strncpy(events->items[events->count].userId, userId, ID_LENGTH); // Copy user ID
+    strncpy(events->items[events->count].eventType, eventType, EVENT_TYPE_LENGTH); // Copy event type
+    events->items[events->count].timestamp = getCurrentTimestamp(); // Get current time
+    indexEvent(events, events->count); // Add it to the user and time indexes
+    events->count++; // Increment event count
+
+    // Hand the event to the writer thread, or write it now if the thread could not be started
+    if (!pushEvent(&events->writer, &events->items[events->count - 1])) {
+        printf("Error: Unable to save the event.\n");
+    } else if (!events->writer.running) {
+        writeQueuedEvents(&events->writer);
+    }
+}
+
+
+// Function to set up the event queue and start the thread that appends queued events to the events file
+// Returns false if the thread could not be started; the queue still works and logEvent then writes each event itself
+bool startEventWriter(EventWriter *writer, Persistence *disk) {
+    // The queue always holds one node whose event was already written, so producers never see it empty
+    EventNode *stub = calloc(1, sizeof(EventNode));
+    if (stub == NULL) {
+        perror("Failed to allocate memory for event queue");
+        return false;
+    }
+    atomic_init(&stub->next, NULL);
+    atomic_init(&writer->head, stub);
+    writer->tail = stub;
+    atomic_init(&writer->stopping, false);
+    writer->disk = disk;
+    pthread_mutex_init(&writer->wakeLock, NULL);
+    pthread_cond_init(&writer->wake, NULL);
+
+    writer->running = pthread_create(&writer->thread, NULL, runEventWriter, writer) == 0;
+    if (!writer->running) {
+        printf("Warning: Unable to start the event writer, events will be written as they are logged.\n");
+    }
+    return writer->running;
+}
+
+
+// Function to stop the writer thread once every queued event is written, and release the queue
+void stopEventWriter(EventWriter *writer) {
+    if (writer->tail == NULL) {
+        return; // Never started
+    }
+
+    if (writer->running) {
+        pthread_mutex_lock(&writer->wakeLock);
+        atomic_store(&writer->stopping, true);
+        pthread_cond_signal(&writer->wake);
+        pthread_mutex_unlock(&writer->wakeLock);
+        pthread_join(writer->thread, NULL);
+        writer->running = false;
+    }
+    writeQueuedEvents(writer); // Anything the thread could not write
+
+    // Free whatever is left (events that failed to write, and the stub)
+    while (writer->tail != NULL) {
+        EventNode *next = atomic_load(&writer->tail->next);
+        free(writer->tail);
+        writer->tail = next;
+    }
+    atomic_store(&writer->head, NULL);
+    pthread_cond_destroy(&writer->wake);
+    pthread_mutex_destroy(&writer->wakeLock);
+}
+
+
+// Function to queue an event for the writer thread; safe to call from any number of threads at once
+bool pushEvent(EventWriter *writer, const LoginLogoutEvent *event) {
+    if (atomic_load_explicit(&writer->head, memory_order_relaxed) == NULL) {
+        return false; // The writer was never started
+    }
+
+    EventNode *node = malloc(sizeof(EventNode));
+    if (node == NULL) {
+        perror("Failed to allocate memory for event queue");
+        return false;
+    }
+    node->event = *event;
+    atomic_store_explicit(&node->next, NULL, memory_order_relaxed);
+
+    // Become the newest node, then link the previous newest one to it; until the link is made the writer
+    // simply stops one short and picks this event up on its next pass
+    EventNode *previous = atomic_exchange_explicit(&writer->head, node, memory_order_acq_rel);
+    atomic_store_explicit(&previous->next, node, memory_order_release);
+
+    // The writer is not woken: a burst of logins just piles up in the queue and is written in one go
+    // on the writer's next pass, instead of each wake-up taking the CPU from the terminal
+    return true;
+}
+
+
+// Function to append every queued event to the events file in a single append
+// Only one thread may call this at a time: the writer thread, or the logging thread when there is no writer thread.
+// Events stay queued if the write fails and are tried again on the next pass
+void writeQueuedEvents(EventWriter *writer) {
+    if (atomic_load_explicit(&writer->tail->next, memory_order_acquire) == NULL) {
+        return; // Nothing to write
+    }
+
+    // Format the whole batch first so it reaches the file in one write call
+    char *text = NULL;
+    size_t length = 0;
+    FILE *buffer = open_memstream(&text, &length);
+    if (buffer == NULL) {
+        perror("Failed to allocate memory for events");
+        return;
+    }
+    EventNode *last = writer->tail;
+    EventNode *next;
+    while ((next = atomic_load_explicit(&last->next, memory_order_acquire)) != NULL) {
+        char timestamp[DATE_TIME_LENGTH];
+        formatTimestamp(next->event.timestamp, timestamp, DATE_TIME_LENGTH);
+        fprintf(buffer, "%d, %s, %s, %s\n", next->event.orderNum, next->event.userId, next->event.eventType, timestamp);
+        last = next;
+    }
+    fclose(buffer);
+
+    bool written = appendToFile(writer->disk, EVENTS_FILE, text, length);
+    free(text);
+    if (!written) {
+        printf("Error appending to events file.\n");
+        return; // Keep the events queued and try again on the next pass
+    }
+
+    // Drop the written nodes; the last one becomes the new stub
+    while (writer->tail != last) {
+        EventNode *done = writer->tail;
+        writer->tail = atomic_load_explicit(&done->next, memory_order_relaxed);
+        free(done);
+    }
+}
+
+
+// Function run by the event writer thread: write the queued events every EVENT_FLUSH_INTERVAL seconds
+// until stopEventWriter is called
+void* runEventWriter(void *arg) {
+    EventWriter *writer = arg;
+    bool stopping = false;
+
+    while (!stopping) {
+        pthread_mutex_lock(&writer->wakeLock);
+        if (!atomic_load(&writer->stopping)) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_sec += EVENT_FLUSH_INTERVAL;
+            pthread_cond_timedwait(&writer->wake, &writer->wakeLock, &deadline);
+        }
+        stopping = atomic_load(&writer->stopping);
+        pthread_mutex_unlock(&writer->wakeLock);
+
+        writeQueuedEvents(writer);
+    }
+    return NULL;
+}
+
+
+// Function to add the event at a position to its user's posting list and check it keeps the time order
+void indexEvent(EventStore *events, int position) {
+    const LoginLogoutEvent *event = &events->items[position];
+    if (position > 0 && event->timestamp < events->items[position - 1].timestamp) {
+        events->inTimeOrder = false; // The clock went backwards; time searches fall back to a full scan
+    }
+
+    int userHandle = internString(&events->userIds, event->userId);
+    if (userHandle != -1) {
+        appendToHandleList(&events->userEvents, &events->userEventCapacity, userHandle, position);
+    }
+}
+
+
+// Function to find the position of the first event logged at or after a time
+int findFirstEventAt(EventStore *events, long long timestamp) {
+    int low = 0, high = events->count;
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        if (events->items[mid].timestamp < timestamp) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+
+// Function to display one event
+void displayEvent(const LoginLogoutEvent *event) {
+    char timestamp[DATE_TIME_LENGTH];
+    formatTimestamp(event->timestamp, timestamp, DATE_TIME_LENGTH);
+    printf("Order Number: %d\n", event->orderNum);
+    printf("User ID: %s\n", event->userId);
+    printf("Event Type: %s\n", event->eventType);
+    printf("Timestamp: %s\n", timestamp);
+    printf("-------------------------------------------\n");
+}
+
+
+// Function to free memory allocated for the event store
+void freeEvents(EventStore *events) {
+    if (!events->itemsMapped) {
+        free(events->items);
+    }
+    for (int i = 0; i < events->userEventCapacity; i++) {
+        free(events->userEvents[i].handles);
+    }
+    free(events->userEvents);
+    freeStringPool(&events->userIds);
+    memset(events, 0, sizeof(EventStore));
+}
+
+
+// Function to search for events by User ID
+void searchEventsByUserId(EventStore *events) {
+    if (events->count == 0) {
+        printf("No events available.\n");
+        return;
+    }
+
+    // Get User ID from the user
+    char userId[ID_LENGTH];
+    printf("Enter User ID to search: ");
+    fgets(userId, ID_LENGTH, stdin);
+    userId[strcspn(userId, "\n")] = '\0'; // Remove newline character
+
+    // Display events for the specified User ID
+    printf("Event History for User ID '%s':\n", userId);
+    printf("===========================================\n");
+    int userHandle = findInternedString(&events->userIds, userId);
+    if (userHandle >= 0 && userHandle < events->userEventCapacity) {
+        // Only touch this user's events
+        HandleList *list = &events->userEvents[userHandle];
+        for (int i = 0; i < list->count; i++) {
+            displayEvent(&events->items[list->handles[i]]);
+        }
+    }
+}
+
+
+// Function to search for events within a specified date range
+void searchEventsByDateRange(EventStore *events) {
+    if (events->count == 0) {
+        printf("No events available.\n");
+        return;
+    }
+
+    // Get start and end dates from the user
+    char startDate[DATE_LENGTH], endDate[DATE_LENGTH];
+    // Prompt user to enter start date and validate
+    getValidDate(startDate, "Enter start date (YYYY-MM-DD): ", 1, NULL); // allowPastDate is set to 1 (true)
+
+    // Prompt user to enter end date and validate, ensuring it's later than start date
+    do {
+        getValidDate(endDate, "Enter end date (YYYY-MM-DD): ", 1, NULL); // allowPastDate is set to 1 (true)
+
+        // Check if end date is later than start date
+        if (strcmp(startDate, endDate) >= 0) {
+            printf("End date must be later than start date. Please enter again.\n");
+        }
+    } while (strcmp(startDate, endDate) >= 0);
+
+    // Display events within the specified date range
+    printf("Event History within Date Range (%s - %s):\n", startDate, endDate);
+    printf("===========================================\n");
+    // The range runs from midnight of the start date up to, but not including, midnight of the end date
+    long long start = (long long)dateToDayNumber(startDate) * 86400;
+    long long end = (long long)dateToDayNumber(endDate) * 86400;
+
+    // Events are logged in time order, so binary search to the start and stop at the end
+    int first = events->inTimeOrder ? findFirstEventAt(events, start) : 0;
+    for (int i = first; i < events->count; i++) {
+        if (events->items[i].timestamp >= end && events->inTimeOrder) {
+            break;
+        }
+        // Check if event timestamp falls within the specified range
+        if (events->items[i].timestamp >= start && events->items[i].timestamp < end) {
+            displayEvent(&events->items[i]);
+        }
+    }
+}
+
+
+// Function to manage events
+void manageEvents(EventStore *events) {
+    int choice = 0;
+    while (choice != 3) {
+        printf("\n========== MANAGE EVENTS =========\n");
+        printf("1. Search for events by User ID\n");
+        printf("2. Search for events by specificied duration\n");
+        printf("3. Exit\n");
+        printf("=================================\n");
+        printf("Enter your choice: ");
+        scanf("%d", &choice);
+        getchar(); // Consume the newline character left in the input buffer
+        
+        switch (choice) {
+            case 1: 
+                searchEventsByUserId(events);
+                break;
+            case 2: 
+                searchEventsByDateRange(events);
+                break;
+            case 3: 
+                printf("Exiting... Thank you!\n"); 
+                break;
+            default: 
+                printf("Invalid choice. Please try again.\n");
+        }
+    }
+}
+
+
+// PERSISTENCE FUNCTIONS
+
+// Function to read the name of a durability mode given with --durability
+bool parseDurabilityMode(const char *name, DurabilityMode *mode) {
+    if (strcmp(name, "none") == 0) {
+        *mode = DURABILITY_NONE;
+    } else if (strcmp(name, "async") == 0) {
+        *mode = DURABILITY_ASYNC;
+    } else if (strcmp(name, "fsync") == 0) {
+        *mode = DURABILITY_FSYNC;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+
+// Function to set up the persistence layer and, in async and fsync mode, start the committer thread
+// If the thread cannot be started every append is written, and in fsync mode synced, by its caller
+void startPersistence(Persistence *disk, DurabilityMode mode) {
+    memset(disk, 0, sizeof(Persistence));
+    disk->mode = mode;
+    pthread_mutex_init(&disk->lock, NULL);
+    pthread_mutex_init(&disk->writeLock, NULL);
+    pthread_cond_init(&disk->wake, NULL);
+    pthread_cond_init(&disk->done, NULL);
+
+    if (mode != DURABILITY_NONE) {
+        disk->running = pthread_create(&disk->thread, NULL, runCommitter, disk) == 0;
+        if (!disk->running) {
+            printf("Warning: Unable to start the committer, every change will be written as it is made.\n");
+        }
+    }
+}
+
+
+// Function to stop the committer once it has written and synced every append it still holds
+// The layer keeps working afterwards, with every append written by its caller
+void stopPersistence(Persistence *disk) {
+    if (!disk->running) {
+        return;
+    }
+
+    pthread_mutex_lock(&disk->lock);
+    disk->stopping = true;
+    pthread_cond_signal(&disk->wake);
+    pthread_mutex_unlock(&disk->lock);
+    pthread_join(disk->thread, NULL);
+    disk->running = false;
+}
+
+
+// Function to append records to a journal or the events file as the durability mode asks:
+// none writes them at once, async only buffers them for the committer, and fsync writes them and then waits
+// for the committer's next fsync of the file, which every append made while the previous one ran shares.
+// Returns false if the records could not be written; in async mode a failed write is reported by the committer
+bool appendToFile(Persistence *disk, const char *path, const char *data, size_t length) {
+    if (disk->mode == DURABILITY_ASYNC && disk->running) {
+        pthread_mutex_lock(&disk->lock);
+        AppendFile *file = disk->stopping ? NULL : findAppendFile(disk, path);
+        if (file != NULL && file->length + length > file->capacity) {
+            size_t capacity = file->capacity == 0 ? 4096 : file->capacity;
+            while (capacity < file->length + length) {
+                capacity *= 2;
+            }
+            char *grown = realloc(file->buffer, capacity);
+            if (grown != NULL) {
+                file->buffer = grown;
+                file->capacity = capacity;
+            }
+        }
+        bool buffered = file != NULL && file->length + length <= file->capacity;
+        if (buffered) {
+            memcpy(file->buffer + file->length, data, length);
+            file->length += length;
+        }
+        pthread_mutex_unlock(&disk->lock);
+        if (buffered) {
+            return true;
+        }
+        // Out of memory or stopping: write the records directly instead
+    }
+
+    if (!writeToFile(path, data, length)) {
+        return false;
+    }
+    if (disk->mode != DURABILITY_FSYNC) {
+        return true;
+    }
+
+    pthread_mutex_lock(&disk->lock);
+    AppendFile *file = disk->running && !disk->stopping ? findAppendFile(disk, path) : NULL;
+    if (file == NULL) {
+        pthread_mutex_unlock(&disk->lock);
+        return syncFile(path); // No committer to share the fsync with
+    }
+
+    // Take a ticket and wait until a commit covers it
+    file->dirty = true;
+    long long ticket = ++disk->appended;
+    pthread_cond_signal(&disk->wake);
+    while (disk->committed < ticket) {
+        pthread_cond_wait(&disk->done, &disk->lock);
+    }
+    pthread_mutex_unlock(&disk->lock);
+    return true;
+}
+
+
+// Function to find the committer's entry for an appended file, claiming a free entry the first time
+// Returns NULL if every entry is taken; the caller must hold disk->lock
+AppendFile* findAppendFile(Persistence *disk, const char *path) {
+    for (int i = 0; i < APPEND_FILE_COUNT; i++) {
+        if (disk->files[i].path == NULL) {
+            disk->files[i].path = path;
+            return &disk->files[i];
+        }
+        if (strcmp(disk->files[i].path, path) == 0) {
+            return &disk->files[i];
+        }
+    }
+    return NULL;
+}
+
+
+// Function to append data to a file in a single write, creating the file if needed
+bool writeToFile(const char *path, const char *data, size_t length) {
+    int fd = open(path, O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if (fd == -1) {
+        return false;
+    }
+    bool written = writeAll(fd, data, length);
+    close(fd);
+    return written;
+}
+
+
+// Function to flush a file, or a directory after a rename in it, to the disk
+// A file that is gone needs no sync: it was replaced by a rewrite that was synced itself
+bool syncFile(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        return errno == ENOENT;
+    }
+    bool synced = fsync(fd) == 0;
+    if (!synced) {
+        perror("Error: Unable to sync file to disk");
+    }
+    close(fd);
+    return synced;
+}
+
+
+// Function to finish a full rewrite: the data written to tempPath replaces path in a single rename, and the
+// journal whose changes the data now contains, if any, is removed along with its buffered appends.
+// Closes file; on failure the old file and its journal are left as they were
+bool replaceFile(Persistence *disk, FILE *file, const char *tempPath, const char *path, const char *journalPath) {
+    // Outside none mode the data must reach the disk before the rename, or a crash could leave path empty
+    bool written = fflush(file) == 0 && (disk->mode == DURABILITY_NONE || fsync(fileno(file)) == 0);
+    if (fclose(file) != 0) {
+        written = false;
+    }
+    if (!written) {
+        printf("Error: Unable to write %s.\n", tempPath);
+        remove(tempPath);
+        return false;
+    }
+
+    // Keep the committer from writing to the journal while it is dropped
+    pthread_mutex_lock(&disk->writeLock);
+    bool replaced = rename(tempPath, path) == 0;
+    if (!replaced) {
+        printf("Error: Unable to replace %s.\n", path);
+        remove(tempPath);
+    } else {
+        if (disk->mode == DURABILITY_FSYNC) {
+            syncFile("."); // Make the rename itself durable
+        }
+        if (journalPath != NULL) {
+            pthread_mutex_lock(&disk->lock);
+            AppendFile *journal = findAppendFile(disk, journalPath);
+            if (journal != NULL) {
+                journal->length = 0;
+                journal->dirty = false;
+            }
+            pthread_mutex_unlock(&disk->lock);
+            remove(journalPath);
+        }
+    }
+    pthread_mutex_unlock(&disk->writeLock);
+    return replaced;
+}
+
+
+// Function to write the buffered appends and sync every file written since the last commit, then wake the
+// callers waiting for it; disk->lock is held on entry and on return, but not while the disk is busy.
+// The batch is taken and written under writeLock, so a rewrite that drops a journal either drops the batch
+// with it or waits until the batch is in the old journal, never letting it reach the new one
+void commitAppends(Persistence *disk) {
+    pthread_mutex_unlock(&disk->lock);
+    pthread_mutex_lock(&disk->writeLock);
+    pthread_mutex_lock(&disk->lock);
+
+    // Take the batch so new appends can start the next one meanwhile
+    AppendFile batch[APPEND_FILE_COUNT];
+    memcpy(batch, disk->files, sizeof(batch));
+    for (int i = 0; i < APPEND_FILE_COUNT; i++) {
+        disk->files[i].buffer = NULL;
+        disk->files[i].length = 0;
+        disk->files[i].capacity = 0;
+        disk->files[i].dirty = false;
+    }
+    long long target = disk->appended;
+    pthread_mutex_unlock(&disk->lock);
+
+    for (int i = 0; i < APPEND_FILE_COUNT; i++) {
+        if (batch[i].length > 0 && !writeToFile(batch[i].path, batch[i].buffer, batch[i].length)) {
+            printf("Error: Unable to append to %s.\n", batch[i].path);
+        } else if (batch[i].length > 0 || batch[i].dirty) {
+            syncFile(batch[i].path);
+        }
+        free(batch[i].buffer);
+    }
+    pthread_mutex_unlock(&disk->writeLock);
+
+    pthread_mutex_lock(&disk->lock);
+    disk->committed = target;
+    pthread_cond_broadcast(&disk->done);
+}
+
+
+// Function run by the committer thread until stopPersistence is called
+// Fsync mode: sleep until an append waits, then sync every file written since the last commit in one go; the
+// appends that arrive while the disk is busy form the next group, so the busier the disk the more each fsync covers.
+// Async mode: write and sync whatever was buffered every ASYNC_COMMIT_INTERVAL_MS
+void* runCommitter(void *arg) {
+    Persistence *disk = arg;
+
+    pthread_mutex_lock(&disk->lock);
+    while (!disk->stopping) {
+        if (disk->mode == DURABILITY_FSYNC) {
+            if (disk->committed == disk->appended) {
+                pthread_cond_wait(&disk->wake, &disk->lock);
+                continue;
+            }
+        } else {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += ASYNC_COMMIT_INTERVAL_MS * 1000000L;
+            deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+            deadline.tv_nsec %= 1000000000L;
+            pthread_cond_timedwait(&disk->wake, &disk->lock, &deadline);
+        }
+        commitAppends(disk);
+    }
+    commitAppends(disk); // Whatever arrived before the stop
+    pthread_mutex_unlock(&disk->lock);
+    return NULL;
+}
+
+
+// SNAPSHOT FUNCTIONS
+
+// Function to record the size, modification time and inode of each text data file
+// A missing file is stamped with size -1 so that creating it later invalidates the snapshot
+// Modification times only have one-second resolution, so a file changed in the same second as writtenAt
+// could change again without its stamp changing; such files are also stamped with a hash of their contents
+void stampDataFiles(FileStamp *stamps, long long writtenAt) {
+    const char *paths[SNAPSHOT_FILE_COUNT] = { USERS_FILE, USERS_JOURNAL_FILE, ROOMS_FILE, ROOMS_JOURNAL_FILE, BOOKINGS_FILE, BOOKINGS_JOURNAL_FILE, EVENTS_FILE };
+
+    for (int i = 0; i < SNAPSHOT_FILE_COUNT; i++) {
+        struct stat info;
+        memset(&stamps[i], 0, sizeof(FileStamp));
+        if (stat(paths[i], &info) == -1) {
+            stamps[i].size = -1;
+            continue;
+        }
+        stamps[i].size = info.st_size;
+        stamps[i].mtime = info.st_mtime;
+        stamps[i].inode = info.st_ino;
+        if (stamps[i].mtime >= writtenAt) {
+            stamps[i].hashed = hashFileContents(paths[i], &stamps[i].contentHash);
+        }
+    }
+}
+
+
+// Function to compute a 64-bit FNV-1a hash of a whole file
+bool hashFileContents(const char *path, unsigned long long *hash) {
+    RecordReader reader;
+    if (!openRecordReader(&reader, path)) {
+        return false;
+    }
+
+    unsigned long long value = 14695981039346656037ULL;
+    for (size_t i = 0; i < reader.size; i++) {
+        value = (value ^ (unsigned char)reader.data[i]) * 1099511628211ULL;
+    }
+    closeRecordReader(&reader);
+
+    *hash = value;
+    return true;
+}
+
+
+// Function to stamp the text data files just before the stores are loaded from them
+void stampLoadedFiles(DataFileStamps *loaded) {
+    loaded->stampedAt = time(NULL);
+    stampDataFiles(loaded->files, loaded->stampedAt);
+}
+
+
+// Function to check whether the text data files still have the stamps they had earlier
+// current must be stamped with the same time as saved
+bool sameFileStamps(const FileStamp *saved, const FileStamp *current) {
+    for (int i = 0; i < SNAPSHOT_FILE_COUNT; i++) {
+        if (current[i].size != saved[i].size || current[i].mtime != saved[i].mtime || current[i].inode != saved[i].inode) {
+            return false;
+        }
+        // A file stamped in the same second it was last written must also still have the same contents
+        if (saved[i].hashed && (!current[i].hashed || current[i].contentHash != saved[i].contentHash)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+// Function to check whether a snapshot header still describes the text data files
+bool isSnapshotCurrent(const SnapshotHeader *header) {
+    FileStamp stamps[SNAPSHOT_FILE_COUNT];
+    stampDataFiles(stamps, header->writtenAt);
+    return sameFileStamps(header->stamps, stamps);
+}
+
+
+// Function to write one section of the snapshot and record where it landed in the header
+bool writeSnapshotSection(FILE *file, SnapshotHeader *header, SnapshotSectionId id, const void *records, long long count, int recordSize) {
+    // Keep every section 8-byte aligned so the mapped records can be read in place
+    long offset = ftell(file);
+    while (offset % 8 != 0) {
+        fputc(0, file);
+        offset++;
+    }
+
+    header->sections[id].offset = offset;
+    header->sections[id].count = count;
+    header->sections[id].recordSize = recordSize;
+    return count == 0 || fwrite(records, recordSize, count, file) == (size_t)count;
+}
+
+
+// Function to write the binary snapshot of all four stores next to the text files
+// The snapshot is only a cache of the text files; it is rebuilt whenever they change.
+// It is stamped with the files as they were loaded, the state the stores actually reflect
+void saveSnapshot(UserStore *users, RoomStore *rooms, BookingStore *bookings, EventStore *events, const DataFileStamps *loaded) {
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(SnapshotHeader));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.headerSize = sizeof(SnapshotHeader);
+    header.maxBookingId = bookings->maxId;
+    header.writtenAt = loaded->stampedAt;
+    memcpy(header.stamps, loaded->files, sizeof(header.stamps));
+
+    // If any file changed since it was loaded, by this terminal or another one, the stores may be missing
+    // that change; leave the snapshot to the next start, which parses the text files again
+    FileStamp stamps[SNAPSHOT_FILE_COUNT];
+    stampDataFiles(stamps, loaded->stampedAt);
+    if (!sameFileStamps(loaded->files, stamps)) {
+        return;
+    }
+
+    // Nothing to do if the existing snapshot already matches the text files
+    FILE *existing = fopen(SNAPSHOT_FILE, "rb");
+    if (existing != NULL) {
+        SnapshotHeader current;
+        bool upToDate = fread(&current, sizeof(SnapshotHeader), 1, existing) == 1 &&
+                        memcmp(current.magic, SNAPSHOT_MAGIC, sizeof(current.magic)) == 0 &&
+                        current.version == SNAPSHOT_VERSION &&
+                        isSnapshotCurrent(&current);
+        fclose(existing);
+        if (upToDate) {
+            return;
+        }
+    }
+
+    // Write to a temporary file and rename it so a crash never leaves a half-written snapshot
+    FILE *file = fopen(SNAPSHOT_TEMP_FILE, "wb");
+    if (file == NULL) {
+        perror("Error: Unable to open snapshot file for writing");
+        return;
+    }
+
+    // Reserve space for the header; it is rewritten once the section offsets are known
+    bool ok = fwrite(&header, sizeof(SnapshotHeader), 1, file) == 1;
+
+    ok = ok && writeSnapshotSection(file, &header, SNAPSHOT_USERS, users->items, users->count, sizeof(User));
+    ok = ok && writeSnapshotSection(file, &header, SNAPSHOT_ROOMS, rooms->items, rooms->count, sizeof(Room));
+
+    // Amenity names are stored as fixed-length records in bit order
+    ok = ok && writeSnapshotSection(file, &header, SNAPSHOT_AMENITY_NAMES, NULL, 0, AMENITY_LENGTH);
+    header.sections[SNAPSHOT_AMENITY_NAMES].count = rooms->amenityNames.count;
+    for (int i = 0; ok && i < rooms->amenityNames.count; i++) {
+        char name[AMENITY_LENGTH] = {0};
+        strncpy(name, internedString(&rooms->amenityNames, i), AMENITY_LENGTH - 1);
+        ok = fwrite(name, AMENITY_LENGTH, 1, file) == 1;
+    }
+
+    // Bookings are written chunk by chunk; the chunks follow each other in the file
+    ok = ok && writeSnapshotSection(file, &header, SNAPSHOT_BOOKINGS, NULL, 0, sizeof(Booking));
+    header.sections[SNAPSHOT_BOOKINGS].count = bookings->count;
+    for (int handle = 0; ok && handle < bookings->count; handle += BOOKING_CHUNK_SIZE) {
+        int inChunk = bookings->count - handle < BOOKING_CHUNK_SIZE ? bookings->count - handle : BOOKING_CHUNK_SIZE;
+        ok = fwrite(getBooking(bookings, handle), sizeof(Booking), inChunk, file) == (size_t)inChunk;
+    }
+
+    // Customer IDs are stored as fixed-length records in handle order
+    ok = ok && writeSnapshotSection(file, &header, SNAPSHOT_BOOKING_USER_IDS, NULL, 0, ID_LENGTH);
+    header.sections[SNAPSHOT_BOOKING_USER_IDS].count = bookings->userIds.count;
+    for (int i = 0; ok && i < bookings->userIds.count; i++) {
+        char userId[ID_LENGTH] = {0};
+        strncpy(userId, internedString(&bookings->userIds, i), ID_LENGTH - 1);
+        ok = fwrite(userId, ID_LENGTH, 1, file) == 1;
+    }
+
+    ok = ok && writeSnapshotSection(file, &header, SNAPSHOT_BOOKING_ID_SLOTS, bookings->idIndex.slots, bookings->idIndex.capacity, sizeof(int));
+    ok = ok && writeSnapshotSection(file, &header, SNAPSHOT_EVENTS, events->items, events->count, sizeof(LoginLogoutEvent));
+
+    // Fill in the real header
+    ok = ok && fseek(file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(SnapshotHeader), 1, file) == 1;
+
+    if (fclose(file) != 0 || !ok) {
+        perror("Error: Unable to write snapshot file");
+        remove(SNAPSHOT_TEMP_FILE);
+        return;
+    }
+    if (rename(SNAPSHOT_TEMP_FILE, SNAPSHOT_FILE) != 0) {
+        perror("Error: Unable to replace snapshot file");
+        remove(SNAPSHOT_TEMP_FILE);
+    }
+}
+
+
+// Function to find a section of a mapped snapshot, checking that it lies inside the file
+const void* snapshotSection(const char *base, size_t size, const SnapshotHeader *header, SnapshotSectionId id, int recordSize) {
+    const SnapshotSection *section = &header->sections[id];
+    if (section->recordSize != recordSize || section->count < 0 || section->offset < (long long)sizeof(SnapshotHeader) ||
+        section->offset % 8 != 0 || (unsigned long long)section->offset > size ||
+        (unsigned long long)section->count > (size - section->offset) / recordSize) {
+        return NULL;
+    }
+    return base + section->offset;
+}
+
+
+// Function to load all four stores from the binary snapshot
+// Returns false, leaving the stores empty, if there is no snapshot or it no longer matches the text files
+// On success loaded receives the stamps the snapshot was taken with, and mapping the mapping the stores now
+// point into; it must stay mapped until the stores are freed
+bool loadSnapshot(UserStore *users, RoomStore *rooms, BookingStore *bookings, EventStore *events, DataFileStamps *loaded, SnapshotMapping *mapping) {
+    mapping->base = NULL;
+    mapping->size = 0;
+    int fd = open(SNAPSHOT_FILE, O_RDONLY);
+    if (fd == -1) {
+        return false; // No snapshot yet, the text files will be parsed
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) == -1 || info.st_size < (off_t)sizeof(SnapshotHeader)) {
+        close(fd);
+        return false;
+    }
+
+    // Map the file privately rather than reading it: the records are used where they are, pages are only
+    // read when they are touched and copied when they are first changed, and the file itself is never written
+    size_t size = info.st_size;
+    char *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        return false;
+    }
+
+    const SnapshotHeader *header = (const SnapshotHeader *)base;
+    const User *userRecords = NULL;
+    const Room *roomRecords = NULL;
+    const char *amenityRecords = NULL;
+    const Booking *bookingRecords = NULL;
+    const char *userIdRecords = NULL;
+    const int *idSlots = NULL;
+    const LoginLogoutEvent *eventRecords = NULL;
+
+    bool ok = memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) == 0 &&
+              header->version == SNAPSHOT_VERSION &&
+              header->headerSize == sizeof(SnapshotHeader) &&
+              isSnapshotCurrent(header);
+    if (ok) {
+        userRecords = snapshotSection(base, size, header, SNAPSHOT_USERS, sizeof(User));
+        roomRecords = snapshotSection(base, size, header, SNAPSHOT_ROOMS, sizeof(Room));
+        amenityRecords = snapshotSection(base, size, header, SNAPSHOT_AMENITY_NAMES, AMENITY_LENGTH);
+        bookingRecords = snapshotSection(base, size, header, SNAPSHOT_BOOKINGS, sizeof(Booking));
+        userIdRecords = snapshotSection(base, size, header, SNAPSHOT_BOOKING_USER_IDS, ID_LENGTH);
+        idSlots = snapshotSection(base, size, header, SNAPSHOT_BOOKING_ID_SLOTS, sizeof(int));
+        eventRecords = snapshotSection(base, size, header, SNAPSHOT_EVENTS, sizeof(LoginLogoutEvent));
+        ok = userRecords != NULL && roomRecords != NULL && amenityRecords != NULL && bookingRecords != NULL &&
+             userIdRecords != NULL && idSlots != NULL && eventRecords != NULL;
+    }
+
+    int userCount = ok ? header->sections[SNAPSHOT_USERS].count : 0;
+    int roomCount = ok ? header->sections[SNAPSHOT_ROOMS].count : 0;
+    int amenityCount = ok ? header->sections[SNAPSHOT_AMENITY_NAMES].count : 0;
+    int bookingCount = ok ? header->sections[SNAPSHOT_BOOKINGS].count : 0;
+    int userIdCount = ok ? header->sections[SNAPSHOT_BOOKING_USER_IDS].count : 0;
+    int slotCount = ok ? header->sections[SNAPSHOT_BOOKING_ID_SLOTS].count : 0;
+    int eventCount = ok ? header->sections[SNAPSHOT_EVENTS].count : 0;
+
+    // The ID index is a power-of-two table with room for every booking
+    ok = ok && (slotCount & (slotCount - 1)) == 0 && slotCount >= bookingCount * 2;
+
+    // Use the fixed-size stores in place
+    if (ok) {
+        users->items = (User*)userRecords;
+        users->itemsMapped = true;
+        users->count = users->capacity = userCount;
+        indexUsers(users);
+        rooms->items = (Room*)roomRecords;
+        rooms->itemsMapped = true;
+        rooms->count = rooms->capacity = roomCount;
+        indexRooms(rooms);
+        buildRoomCatalog(rooms);
+        events->items = (LoginLogoutEvent*)eventRecords;
+        events->itemsMapped = true;
+        events->count = events->capacity = eventCount;
+        events->inTimeOrder = true;
+        for (int i = 0; i < eventCount; i++) {
+            indexEvent(events, i); // Rebuild the per-user event lists
+        }
+    }
+
+    // Re-intern the amenity names in bit order so room amenity sets stay valid
+    for (int i = 0; ok && i < amenityCount; i++) {
+        char name[AMENITY_LENGTH];
+        memcpy(name, amenityRecords + (size_t)i * AMENITY_LENGTH, AMENITY_LENGTH);
+        name[AMENITY_LENGTH - 1] = '\0';
+        ok = internAmenity(rooms, name) == i;
+    }
+
+    // Re-intern the customer IDs in handle order so booking handles stay valid
+    for (int i = 0; ok && i < userIdCount; i++) {
+        char userId[ID_LENGTH];
+        memcpy(userId, userIdRecords + (size_t)i * ID_LENGTH, ID_LENGTH);
+        userId[ID_LENGTH - 1] = '\0';
+        ok = internString(&bookings->userIds, userId) == i;
+    }
+
+    // Point the arena at the full chunks of bookings in place; the last, partly filled chunk gets memory of
+    // its own, since new bookings are appended to it
+    int chunkCount = (bookingCount + BOOKING_CHUNK_SIZE - 1) / BOOKING_CHUNK_SIZE;
+    if (ok && chunkCount > 0) {
+        bookings->chunks = calloc(chunkCount, sizeof(Booking*));
+        ok = bookings->chunks != NULL;
+        if (ok) {
+            bookings->chunkCapacity = chunkCount;
+        }
+    }
+    for (int chunk = 0; ok && chunk < chunkCount; chunk++) {
+        int first = chunk * BOOKING_CHUNK_SIZE;
+        int inChunk = bookingCount - first < BOOKING_CHUNK_SIZE ? bookingCount - first : BOOKING_CHUNK_SIZE;
+        if (inChunk == BOOKING_CHUNK_SIZE) {
+            bookings->chunks[chunk] = (Booking*)(bookingRecords + first);
+            bookings->mappedChunks = chunk + 1;
+        } else {
+            bookings->chunks[chunk] = malloc(BOOKING_CHUNK_SIZE * sizeof(Booking));
+            ok = bookings->chunks[chunk] != NULL;
+            if (ok) {
+                memcpy(bookings->chunks[chunk], bookingRecords + first, inChunk * sizeof(Booking));
+            }
+        }
+        if (ok) {
+            bookings->count = first + inChunk;
+        }
+    }
+    for (int handle = 0; ok && handle < bookingCount; handle++) {
+        const Booking *current = getBooking(bookings, handle);
+        ok = current->userHandle >= 0 && current->userHandle < userIdCount && current->status <= CANCELLED;
+        if (ok) {
+            indexUserBooking(bookings, handle); // Rebuild the customer booking lists as the bookings are checked
+        }
+    }
+
+    // Take the ID index as saved instead of rehashing every booking
+    for (int i = 0; ok && i < slotCount; i++) {
+        ok = idSlots[i] >= -1 && idSlots[i] < bookingCount;
+    }
+    if (ok && slotCount > 0) {
+        bookings->idIndex.slots = (int*)idSlots;
+        bookings->idIndex.mapped = true;
+        bookings->idIndex.capacity = slotCount;
+        bookings->idIndex.count = bookingCount;
+    }
+    if (ok) {
+        bookings->maxId = header->maxBookingId;
+        loaded->stampedAt = header->writtenAt;
+        memcpy(loaded->files, header->stamps, sizeof(loaded->files));
+    }
+
+    if (!ok) {
+        // Fall back to the text files with clean stores
+        freeBookings(bookings);
+        if (!users->itemsMapped) {
+            free(users->items);
+        }
+        free(users->idIndex.slots);
+        free(users->freeSlots);
+        if (!rooms->itemsMapped) {
+            free(rooms->items);
+        }
+        free(rooms->idIndex.slots);
+        free(rooms->freeSlots);
+        freeRoomCatalog(&rooms->catalog);
+        freeStringPool(&rooms->amenityNames);
+        freeEvents(events);
+        memset(users, 0, sizeof(UserStore));
+        memset(rooms, 0, sizeof(RoomStore));
+        munmap(base, size);
+        return false;
+    }
+
+    mapping->base = base;
+    mapping->size = size;
+    indexRoomStays(bookings);
+    return true;
+}
+
+
+// DAEMON FUNCTIONS
+
+// Function to connect to the daemon's socket
+// Returns the connected socket, or -1 if no daemon is listening
+int connectToDaemon() {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1) {
+        return -1;
+    }
+
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, DAEMON_SOCKET_FILE, sizeof(address.sun_path) - 1);
+    if (connect(fd, (struct sockaddr*)&address, sizeof(address)) == -1) {
+        close(fd);
+        return -1;
+    }
+
+    // Never hang the terminal on a daemon that stopped answering
+    struct timeval timeout = { DAEMON_TIMEOUT, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    return fd;
+}
+
+
+// Function to check whether a daemon is serving the bookings of this directory
+// A leftover socket file of a daemon that was killed refuses the connection, so it does not count
+bool isDaemonRunning() {
+    int fd = connectToDaemon();
+    if (fd == -1) {
+        return false;
+    }
+    close(fd); // The daemon drops a connection that sends nothing
+    return true;
+}
+
+
+// Function to lock the directory against a daemon and terminals working on their own running side by side
+// The daemon takes the lock exclusively and every terminal working on its own takes it shared; the lock file
+// stays open in lock->fd while the process runs
+// Returns false if the lock is held the other way
+bool lockHotelDirectory(DirectoryLock *lock, bool exclusive) {
+    lock->fd = open(DAEMON_LOCK_FILE, O_RDWR | O_APPEND | O_CREAT, 0644);
+    lock->aloneAtStart = false;
+    lock->joinMark = -1;
+    if (lock->fd == -1) {
+        perror("Error: Unable to open lock file");
+        return false;
+    }
+
+    // Whoever gets the lock exclusively is alone, and starts the count of terminals over
+    if (flock(lock->fd, LOCK_EX | LOCK_NB) == 0) {
+        lock->aloneAtStart = true;
+        if (ftruncate(lock->fd, 0) == -1) {
+            perror("Error: Unable to reset lock file");
+        }
+        // Nobody waits for the lock (every other taker gives up at once), so the change to shared loses nothing
+        if (!exclusive && flock(lock->fd, LOCK_SH) == -1) {
+            perror("Error: Unable to share lock file");
+        }
+    } else if (exclusive || flock(lock->fd, LOCK_SH | LOCK_NB) == -1) {
+        close(lock->fd);
+        lock->fd = -1;
+        return false;
     }
 
-    // Generate unique ID for the new booking
-    int uniqueId = generateUniqueId(*head);
-    if (uniqueId == -1) {
-        printf("Error: Unable to generate a unique ID for the reservation.\n");
-        return; // Exit if unable to generate a unique ID
+    if (write(lock->fd, "+", 1) == 1) {
+        lock->joinMark = lseek(lock->fd, 0, SEEK_CUR);
     }
+    return true;
+}
 
-    // Add the new booking node to the list
-    addBookingNode(head, bookingCount, uniqueId, userId, roomId, currentDate, checkInDate, checkOutDate);
-
-    // Save updated bookings to file
-    saveBookings(*head);
 
-    // Display booking details
-    displayBookingIdDetails(&uniqueId, userId, &roomId, "Reserved", currentDate, checkInDate, checkOutDate);
-    printf("Reservation successfully made with booking ID: %d\n", uniqueId);
+// Function to record the start of a terminal of the daemon, which takes no lock
+void announceTerminal(DirectoryLock *lock) {
+    lock->fd = -1;
+    lock->aloneAtStart = false;
+    lock->joinMark = -1;
+    int fd = open(DAEMON_LOCK_FILE, O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if (fd == -1 || write(fd, "+", 1) != 1) {
+        perror("Error: Unable to write lock file");
+    }
+    if (fd != -1) {
+        close(fd);
+    }
 }
 
 
-// Function to cancel a reservation
-void cancelReservation(Booking **head, int *bookingCount, const char *userId) {
-    // If no bookings or error loading bookings, return
-    if (*head == NULL || *bookingCount == 0) {
-        printf("No bookings available.\n");
-        return;
+// Function to check whether no daemon or other terminal ran in the directory since this terminal started
+// On success the lock is held exclusively until the process exits, so nobody starts while the snapshot is written
+bool ranAlone(DirectoryLock *lock) {
+    if (lock->fd == -1 || !lock->aloneAtStart || lock->joinMark == -1) {
+        return false;
     }
+    if (flock(lock->fd, LOCK_EX | LOCK_NB) == -1) {
+        flock(lock->fd, LOCK_SH | LOCK_NB); // A failed change of lock gives up the shared one too
+        return false;
+    }
+    struct stat info;
+    return fstat(lock->fd, &info) == 0 && info.st_size == lock->joinMark;
+}
 
-    // Get input for booking ID
-    int bookingId;
-    printf("Enter booking ID to cancel: ");
-    scanf("%d", &bookingId);
-    getchar(); // Consume newline character
 
-    // Traverse the list of bookings to find the matching booking ID
-    Booking *current = *head;
-    while (current != NULL) {
-        if (current->id == bookingId) {
-            // Check if the booking is in "Reserved" status and user ID matches
-            if (strcmp(current->status, "Reserved") == 0 && strcmp(current->userId, userId) == 0) {
-                // Update the status to "Cancelled" and save the bookings
-                strcpy(current->status, "Cancelled");
-                saveBookings(*head);
-                printf("Reservation cancelled successfully for booking ID: %d\n", bookingId);
-                return; // No need to free memory here
-            } else {
-                printf("Cancellation failed. Either the booking ID or user ID is incorrect, or the booking is not in 'Reserved' status.\n");
-                return; // No need to free memory here
+// Function to read from a socket until the other side finishes sending
+// Returns a malloc'd NUL-terminated buffer, or NULL on a timeout, an error or more than maxSize bytes
+char* readSocket(int fd, size_t maxSize, size_t *size) {
+    size_t capacity = DAEMON_REQUEST_LENGTH;
+    size_t length = 0;
+    char *buffer = malloc(capacity + 1);
+    if (buffer == NULL) {
+        perror("Failed to allocate memory for daemon message");
+        return NULL;
+    }
+
+    while (true) {
+        if (length == capacity) {
+            // Double the buffer, keeping room for the terminator
+            char *grown = realloc(buffer, capacity * 2 + 1);
+            if (grown == NULL) {
+                perror("Failed to allocate memory for daemon message");
+                free(buffer);
+                return NULL;
             }
+            buffer = grown;
+            capacity *= 2;
+        }
+
+        ssize_t got = read(fd, buffer + length, capacity - length);
+        if (got == 0) {
+            break; // The other side is done
+        }
+        if (got < 0 || length + got > maxSize) {
+            free(buffer);
+            return NULL;
         }
-        current = current->next;
+        length += got;
     }
-    printf("Booking ID: %d not found.\n", bookingId);
+
+    buffer[length] = '\0';
+    *size = length;
+    return buffer;
 }
 
 
-// Function to cancel a reservation based on check-in date less than current date
-void autoCancelReservations(Booking **head) {
-    char currentDate[DATE_LENGTH];
-    getCurrentDate(currentDate, DATE_LENGTH);
+// Function to send one request to the daemon and wait for its reply
+// The request is a comma-separated line like a data file record; the first line of the reply is the BookingResult.
+// On BOOKING_DONE reply (when not NULL) is left at the records that follow, and the caller closes it.
+// Problems reaching the daemon are reported here and returned as BOOKING_UNREACHABLE
+BookingResult daemonRequest(RecordReader *reply, const char *format, ...) {
+    // Start with an empty reply so callers can always close it
+    if (reply != NULL) {
+        memset(reply, 0, sizeof(RecordReader));
+    }
 
-    Booking *current = *head;
-    while (current != NULL) {
-        // Compare check-in date with current date
-        if (strcmp(current->status, "Reserved") == 0 && strcmp(current->checkInDate, currentDate) < 0) {
-            // Update status to "Cancelled"
-            strcpy(current->status, "Cancelled");
-            saveBookings(*head);
+    char request[DAEMON_REQUEST_LENGTH];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(request, sizeof(request) - 1, format, args);
+    va_end(args);
+    if (length < 0 || length >= (int)sizeof(request) - 1) {
+        printf("Error: Request is too long for the hotel daemon.\n");
+        return BOOKING_UNREACHABLE;
+    }
+    request[length++] = '\n';
+
+    // One connection per request: send it, signal the end of it and read the reply until the daemon closes
+    char *text = NULL;
+    size_t size = 0;
+    int fd = connectToDaemon();
+    if (fd != -1) {
+        if (writeAll(fd, request, length) && shutdown(fd, SHUT_WR) == 0) {
+            text = readSocket(fd, (size_t)-1, &size);
         }
-        current = current->next;
+        close(fd);
+    }
+    if (text == NULL) {
+        printf("Error: Unable to reach the hotel daemon.\n");
+        return BOOKING_UNREACHABLE;
     }
-}
 
+    RecordReader reader;
+    openRecordBuffer(&reader, DAEMON_SOCKET_FILE, text, size);
+    char *fields[2];
+    int result;
+    if (nextRecord(&reader, fields, 1) != 1 || !parseIntField(fields[0], &result) || result < 0 || result >= BOOKING_UNREACHABLE) {
+        printf("Error: Unexpected reply from the hotel daemon.\n");
+        result = BOOKING_UNREACHABLE;
+    } else if (result == BOOKING_BAD_REQUEST) {
+        printf("Error: The hotel daemon rejected the request.\n");
+        result = BOOKING_UNREACHABLE;
+    }
 
-// Function to perform checking for a booking
-void checkin(Booking *head, int bookingCount) {
-    // If no bookings or error loading bookings, return
-    if (head == NULL || bookingCount == 0) {
-        printf("No bookings available.\n");
-        return;
+    if (reply != NULL && result == BOOKING_DONE) {
+        *reply = reader;
+    } else {
+        closeRecordReader(&reader);
     }
+    return result;
+}
 
-    // Get input for booking ID and user ID
-    int bookingId;
-    char userId[ID_LENGTH];
-    printf("Enter booking ID to check in: ");
-    scanf("%d", &bookingId);
-    getchar(); // Consume newline character
-    printf("Enter user ID: ");
-    fgets(userId, ID_LENGTH, stdin);
-    userId[strcspn(userId, "\n")] = '\0'; // Remove newline character
 
-    // Get the current date
-    char currentDate[DATE_LENGTH];
-    getCurrentDate(currentDate, DATE_LENGTH);
+// Function to create the daemon's listening socket
+// Returns the socket, or -1 if it could not be created
+int openDaemonSocket() {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1) {
+        perror("Error: Unable to create daemon socket");
+        return -1;
+    }
 
-    // Traverse the list of bookings to find the matching booking ID
-    Booking *current = head;
-    while (current != NULL) {
-        if (current->id == bookingId) {
-            // Check if the status allows for check-in
-            if (strcmp(current->status, "Reserved") == 0) {
-                // Check if the user ID matches the one associated with the booking
-                if (strcmp(current->userId, userId) == 0) {
-                    // Check if the check-in date matches the current date
-                    if (strcmp(current->checkInDate, currentDate) == 0) {
-                        // Update the status to "Checked-In" and save the bookings
-                        strcpy(current->status, "Checked-In");
-                        saveBookings(head); // Save the updated bookings to file
-                        printf("Check-in successful for booking ID: %d\n", bookingId);
-                    } else {
-                        printf("Check-in date mismatch for booking ID: %d. Cannot check-in.\n", bookingId);
-                    }
-                } else {
-                    printf("Booking ID: %d cannot be checked in. Reserved by another user.\n", bookingId);
-                }
-            } else if (strcmp(current->status, "Checked-In") == 0) {
-                printf("Booking ID: %d is already checked in.\n", bookingId);
-            } else {
-                printf("Booking ID: %d cannot be checked in. Status must be 'Reserved'.\n", bookingId);
-            }
-            return;
-        }
-        current = current->next;
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, DAEMON_SOCKET_FILE, sizeof(address.sun_path) - 1);
+
+    // The caller made sure no daemon is running, so any socket file left behind is stale
+    unlink(DAEMON_SOCKET_FILE);
+    if (bind(fd, (struct sockaddr*)&address, sizeof(address)) == -1 || listen(fd, SOMAXCONN) == -1) {
+        perror("Error: Unable to listen on daemon socket");
+        close(fd);
+        return -1;
     }
-    printf("Booking ID: %d not found.\n", bookingId);
+    return fd;
 }
 
 
-// Function to perform checkout for a booking
-void checkout(Booking *head, int bookingCount) {
-    // If no bookings or error loading bookings, return
-    if (head == NULL || bookingCount == 0) {
-        printf("No bookings available.\n");
+// Function to serve the bookings to other terminals until SIGINT or SIGTERM
+// Every terminal in the directory then shares this one in-memory booking store, so none of them
+// overwrites the others' changes; the changes still reach the journal as they happen
+void runDaemon(BookingStore *bookings) {
+    HotelDaemon daemon;
+    memset(&daemon, 0, sizeof(HotelDaemon));
+    daemon.bookings = bookings;
+    atomic_init(&daemon.journaled, 0);
+
+    // Shutdown signals are taken by sigwait below; block them before any thread starts so the threads inherit the mask
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+    signal(SIGPIPE, SIG_IGN); // A terminal that goes away mid-reply must not stop the daemon
+
+    daemon.listenFd = openDaemonSocket();
+    if (daemon.listenFd == -1) {
         return;
     }
+    if (pipe(daemon.wakePipe) == -1) {
+        perror("Error: Unable to create daemon wake-up pipe");
+        close(daemon.listenFd);
+        unlink(DAEMON_SOCKET_FILE);
+        return;
+    }
+    pthread_rwlock_init(&daemon.lock, NULL);
+    for (int i = 0; i < DAEMON_ROOM_LOCKS; i++) {
+        pthread_mutex_init(&daemon.roomLocks[i], NULL);
+    }
+    pthread_mutex_init(&daemon.queueLock, NULL);
+    pthread_cond_init(&daemon.queueReady, NULL);
+    pthread_cond_init(&daemon.queueSpace, NULL);
+
+    // Start the worker pool, then the acceptor that feeds it
+    int workerCount = 0;
+    while (workerCount < DAEMON_WORKER_COUNT &&
+           pthread_create(&daemon.workers[workerCount], NULL, serveDaemonConnections, &daemon) == 0) {
+        workerCount++;
+    }
+    bool accepting = workerCount > 0 && pthread_create(&daemon.acceptor, NULL, acceptDaemonConnections, &daemon) == 0;
+    if (accepting) {
+        printf("Hotel daemon serving bookings on %s with %d workers. Press Ctrl+C to stop.\n", DAEMON_SOCKET_FILE, workerCount);
+        fflush(stdout);
+
+        int signalNumber;
+        sigwait(&signals, &signalNumber);
+        printf("\nStopping hotel daemon...\n");
+    } else {
+        printf("Error: Unable to start the daemon threads.\n");
+    }
 
-    // Get input for booking ID and user ID
-    int bookingId;
-    char userId[ID_LENGTH];
-    printf("Enter booking ID to check out: ");
-    scanf("%d", &bookingId);
-    getchar(); // Consume newline character
-    printf("Enter user ID: ");
-    fgets(userId, sizeof(userId), stdin);
-    userId[strcspn(userId, "\n")] = '\0'; // Remove newline character
-
-    // Traverse the list of bookings to find the matching booking ID
-    Booking *current = head;
-    while (current != NULL) {
-        if (current->id == bookingId) {
-            // Check if the booking is in "Checked-In" status and user ID matches
-            if (strcmp(current->status, "Checked-In") == 0 && strcmp(current->userId, userId) == 0) {
-                // Update the status to "Checked-Out" and save the bookings
-                strcpy(current->status, "Checked-Out");
-                saveBookings(head); // Save the updated bookings to file
-                printf("Checkout successful for booking ID: %d\n", bookingId);
-                return;
-            } else {
-                printf("Checkout failed. Either the booking ID or user ID is incorrect, or the booking is not in 'Checked-In' status.\n");
-                return;
-            }
+    // Let the workers finish the connections already queued, then stop every thread
+    pthread_mutex_lock(&daemon.queueLock);
+    daemon.stopping = true;
+    pthread_cond_broadcast(&daemon.queueReady);
+    pthread_cond_broadcast(&daemon.queueSpace);
+    pthread_mutex_unlock(&daemon.queueLock);
+    if (accepting) {
+        if (write(daemon.wakePipe[1], "x", 1) != 1) {
+            perror("Error: Unable to wake the daemon acceptor");
         }
-        current = current->next;
+        pthread_join(daemon.acceptor, NULL);
+    }
+    for (int i = 0; i < workerCount; i++) {
+        pthread_join(daemon.workers[i], NULL);
     }
-    printf("Booking ID: %d not found.\n", bookingId);
-}
-
 
-// Function to view booking history within a specified date range
-void viewBookingHistory(Booking *head, int bookingCount) {
-    // Check if there are any bookings
-    if (head == NULL || bookingCount == 0) {
-        printf("No bookings available.\n");
-        return;
+    close(daemon.listenFd);
+    unlink(DAEMON_SOCKET_FILE);
+    close(daemon.wakePipe[0]);
+    close(daemon.wakePipe[1]);
+    pthread_cond_destroy(&daemon.queueSpace);
+    pthread_cond_destroy(&daemon.queueReady);
+    pthread_mutex_destroy(&daemon.queueLock);
+    for (int i = 0; i < DAEMON_ROOM_LOCKS; i++) {
+        pthread_mutex_destroy(&daemon.roomLocks[i]);
     }
+    pthread_rwlock_destroy(&daemon.lock);
+}
 
-    // Get start and end dates from the user
-    char startDate[DATE_LENGTH], endDate[DATE_LENGTH];
-    // Prompt user to enter start date and validate
-    getValidDate(startDate, "Enter start date (YYYY-MM-DD): ", 1, NULL); // allowPastDate is set to 1 (true)
 
-    // Prompt user to enter end date and validate, ensuring it's later than start date
-    do {
-        getValidDate(endDate, "Enter end date (YYYY-MM-DD): ", 1, NULL); // allowPastDate is set to 1 (true)
+// Function run by the acceptor thread: accept terminal connections and queue them for the workers
+void* acceptDaemonConnections(void *arg) {
+    HotelDaemon *daemon = arg;
+    struct pollfd waits[2] = { { daemon->listenFd, POLLIN, 0 }, { daemon->wakePipe[0], POLLIN, 0 } };
 
-        // Check if end date is later than start date
-        if (strcmp(startDate, endDate) >= 0) {
-            printf("End date must be later than start date. Please enter again.\n");
+    while (true) {
+        if (poll(waits, 2, -1) == -1) {
+            continue; // Interrupted, wait again
+        }
+        if (waits[1].revents != 0) {
+            break; // Shutting down
         }
-    } while (strcmp(startDate, endDate) >= 0);
 
-    // Display booking history within the specified date range
-    printf("Booking History within Date Range (%s - %s):\n", startDate, endDate);
-    printf("===========================================\n");
-    Booking *current = head;
-    while (current != NULL) {
-        // Check if booking date falls within the specified range
-        if (strcmp(current->bookingDate, startDate) >= 0 && strcmp(current->bookingDate, endDate) <= 0) {
-            displayBookingIdDetails(&current->id, current->userId, &current->roomId, current->status, current->bookingDate, current->checkInDate, current->checkOutDate);
+        int fd = accept(daemon->listenFd, NULL, NULL);
+        if (fd == -1) {
+            continue;
+        }
+
+        // Drop a terminal that connects but never finishes its request, instead of tying up a worker
+        struct timeval timeout = { DAEMON_TIMEOUT, 0 };
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+        // Wait for room in the queue while every worker is busy
+        pthread_mutex_lock(&daemon->queueLock);
+        while (daemon->queueCount == DAEMON_QUEUE_LENGTH && !daemon->stopping) {
+            pthread_cond_wait(&daemon->queueSpace, &daemon->queueLock);
         }
-        current = current->next;
+        if (daemon->stopping) {
+            pthread_mutex_unlock(&daemon->queueLock);
+            close(fd);
+            break;
+        }
+        daemon->queue[(daemon->queueHead + daemon->queueCount) % DAEMON_QUEUE_LENGTH] = fd;
+        daemon->queueCount++;
+        pthread_cond_signal(&daemon->queueReady);
+        pthread_mutex_unlock(&daemon->queueLock);
     }
+    return NULL;
 }
 
 
-// Function to check current bookings for a specific user
-void checkCurrentBooking(Booking *head, int bookingCount, const char* userId) {
-    int found = 0; // Flag to indicate if any matching booking is found
-
-    // Check if there are any bookings
-    if (head == NULL || bookingCount == 0) {
-        printf("No bookings available.\n");
-        return;
-    }
+// Function run by each worker thread: answer queued connections until the daemon stops and the queue is empty
+void* serveDaemonConnections(void *arg) {
+    HotelDaemon *daemon = arg;
 
-    // Display current bookings for the specified user
-    printf("Current Bookings for User ID: %s\n", userId);
-    printf("================================\n");
-    Booking *current = head;
-    while (current != NULL) {
-        // Check if the booking is reserved or checked-out and matches the user ID
-        if ((strcmp(current->userId, userId) == 0) && (strcmp(current->status, "Reserved") == 0 || strcmp(current->status, "Checked-In") == 0)) {
-            displayBookingIdDetails(&current->id, current->userId, &current->roomId, current->status, current->bookingDate, current->checkInDate, current->checkOutDate);
-            found = 1; // Set the flag to indicate at least one matching booking is found
+    while (true) {
+        pthread_mutex_lock(&daemon->queueLock);
+        while (daemon->queueCount == 0 && !daemon->stopping) {
+            pthread_cond_wait(&daemon->queueReady, &daemon->queueLock);
         }
-        current = current->next;
-    }
-    
-    // If no matching bookings are found, display a message
-    if (!found) {
-        printf("No current bookings available for your user ID.\n");
+        if (daemon->queueCount == 0) {
+            pthread_mutex_unlock(&daemon->queueLock);
+            break; // Stopping and nothing left to answer
+        }
+        int fd = daemon->queue[daemon->queueHead];
+        daemon->queueHead = (daemon->queueHead + 1) % DAEMON_QUEUE_LENGTH;
+        daemon->queueCount--;
+        pthread_cond_signal(&daemon->queueSpace);
+        pthread_mutex_unlock(&daemon->queueLock);
+
+        serveDaemonConnection(daemon, fd);
+        close(fd);
+        compactBookingJournal(daemon); // After the connection is closed, so its terminal does not wait for the rewrite
     }
+    return NULL;
 }
 
 
-// Function to check booking history for a specific user
-void checkBookingHistory(Booking *head, int bookingCount, const char* userId) {
-    int found = 0; // Flag to indicate if any matching booking is found
+// Function to answer the single request of a terminal connection
+void serveDaemonConnection(HotelDaemon *daemon, int fd) {
+    size_t size;
+    char *request = readSocket(fd, DAEMON_REQUEST_LENGTH, &size);
+    if (request == NULL) {
+        return; // Timed out or too long
+    }
 
-    // Check if there are any bookings
-    if (head == NULL || bookingCount == 0) {
-        printf("No bookings available.\n");
+    RecordReader reader;
+    openRecordBuffer(&reader, DAEMON_SOCKET_FILE, request, size);
+    char *fields[DAEMON_FIELDS + 1];
+    int fieldCount = nextRecord(&reader, fields, DAEMON_FIELDS);
+    if (fieldCount == -1) {
+        closeRecordReader(&reader);
+        return; // An isDaemonRunning probe sends nothing
+    }
+
+    // Build the whole reply in memory so it goes out in one write after the locks are released
+    char *replyText = NULL;
+    size_t replyLength = 0;
+    FILE *reply = open_memstream(&replyText, &replyLength);
+    if (reply == NULL) {
+        perror("Failed to allocate memory for daemon reply");
+        closeRecordReader(&reader);
         return;
     }
 
-    // Display booking history for the specified user
-    printf("Booking History for User ID: %s\n", userId);
-    printf("================================\n");
-    Booking *current = head;
-    while (current != NULL) {
-        // Check if the booking matches the user ID and is either cancelled or checked-out
-        if (strcmp(current->userId, userId) == 0 && (strcmp(current->status, "Cancelled") == 0 || strcmp(current->status, "Checked-Out") == 0)) {
-            displayBookingIdDetails(&current->id, current->userId, &current->roomId, current->status, current->bookingDate, current->checkInDate, current->checkOutDate);
-            found = 1; // Set the flag to indicate at least one matching booking is found
+    // Roll the calendars, cancel missed check-ins and drop expired holds before answering; on most requests
+    // there is nothing to do and the check only needs the read lock
+    pthread_rwlock_rdlock(&daemon->lock);
+    bool maintenanceDue = needsBookingMaintenance(daemon->bookings);
+    pthread_rwlock_unlock(&daemon->lock);
+    if (maintenanceDue) {
+        bool shards[DAEMON_ROOM_LOCKS] = { false };
+        long long *cancelledIds;
+        pthread_rwlock_wrlock(&daemon->lock);
+        rollRoomCalendars(daemon->bookings);
+        int cancelledCount = takeOverdueReservations(daemon->bookings, &cancelledIds);
+        for (int i = 0; i < cancelledCount; i++) {
+            shards[roomLock(daemon, findBookingById(daemon->bookings, cancelledIds[i])->roomId) - daemon->roomLocks] = true;
         }
-        current = current->next;
-    }
+        expireHolds(daemon->bookings);
+        pthread_rwlock_unlock(&daemon->lock);
 
-    // If no matching bookings are found, display a message
-    if (!found) {
-        printf("You do not have any booking history at our hotel.\n");
+        if (cancelledCount > 0) {
+            journalOverdueCancellations(daemon, shards, cancelledIds, cancelledCount);
+        }
+        free(cancelledIds);
     }
-}
 
+    handleDaemonRequest(daemon, fields, fieldCount, reply);
 
-// Function to view room availability for a specific duration
-void checkRoomAvailabilities(Booking **head, Room rooms[], int *roomCount) {
-    char startDate[DATE_LENGTH], endDate[DATE_LENGTH], currentDate[DATE_LENGTH];
+    fclose(reply);
+    writeAll(fd, replyText, replyLength);
+    free(replyText);
+    closeRecordReader(&reader);
+}
 
-    // Get valid dates for the specified duration
-    getCurrentDate(currentDate, DATE_LENGTH);
-    
-    // Get valid start date (must be current date or later)
-    getValidDate(startDate, "Enter start date (YYYY-MM-DD): ", 0, currentDate); 
-    
-    // Get valid end date (must be later than start date)
-    do {
-        getValidDate(endDate, "Enter end date (YYYY-MM-DD): ", 0, startDate);
 
-        // Check if end date is the same as or earlier than start date
-        if (strcmp(startDate, endDate) >= 0) {
-            printf("End date must be later than start date. Please enter again.\n");
+// Function to journal the bookings maintenance cancelled, after the write lock is released so an fsync
+// never holds up the rest of the store. The locks of the cancelled bookings' rooms are held meanwhile, in
+// shard order, so a reservation of one of them still journaling its booking gets its record in first
+void journalOverdueCancellations(HotelDaemon *daemon, const bool *shards, const long long *cancelledIds, int cancelledCount) {
+    for (int i = 0; i < DAEMON_ROOM_LOCKS; i++) {
+        if (shards[i]) {
+            pthread_mutex_lock(&daemon->roomLocks[i]);
         }
-    } while (strcmp(startDate, endDate) >= 0);
-      
-    // Load existing rooms from file
-    loadRooms(rooms, roomCount);
-
-    // Iterate over each room and check availability for the specified duration
-    printf("\nRoom Availabilities for the Duration %s to %s:\n", startDate, endDate);
-    printf("--------------------------------------------------------------\n");
-    int anyRoomAvailable = 0;
-    for (int i = 0; i < *roomCount; i++) {
-        if (rooms[i].active == 1 && isRoomAvailableForBooking(*head, rooms[i].id, startDate, endDate)) {
-            displayRoom(rooms, roomCount, rooms[i].id);
-            anyRoomAvailable++;
+    }
+    journalStatusChanges(daemon->bookings, cancelledIds, cancelledCount, CANCELLED);
+    atomic_fetch_add(&daemon->journaled, cancelledCount);
+    for (int i = 0; i < DAEMON_ROOM_LOCKS; i++) {
+        if (shards[i]) {
+            pthread_mutex_unlock(&daemon->roomLocks[i]);
         }
     }
-    printf("\n%d available room.\n", anyRoomAvailable);
 }
 
 
-// FUNCTION USER LOGIN TRACKING 
-
-// Function to save events to a file
-void saveEvents(LoginLogoutEvent events[], int eventCount) {
-    // Open the event file in write mode
-    FILE *file = fopen(EVENTS_FILE, "w");
-    if (file == NULL) {
-        printf("Error opening events file for writing.\n");
+// Function to fold the bookings journal back into the bookings file once the daemon has appended
+// JOURNAL_COMPACT_THRESHOLD records to it, so a long-running daemon's journal and its next startup stay short.
+// Every change is journaled under its room's lock, so holding all of them, in shard order, leaves no change
+// between the store and the journal; the read lock keeps the store still while saveBookings writes it
+void compactBookingJournal(HotelDaemon *daemon) {
+    if (atomic_load(&daemon->journaled) < JOURNAL_COMPACT_THRESHOLD) {
         return;
     }
 
-    // Write event data to the file
-    for (int i = 0; i < eventCount; i++) {
-        fprintf(file, "%d, %s, %s, %s\n", events[i].orderNum, events[i].userId, events[i].eventType, events[i].timestamp);
+    for (int i = 0; i < DAEMON_ROOM_LOCKS; i++) {
+        pthread_mutex_lock(&daemon->roomLocks[i]);
+    }
+    // Another worker may have compacted the journal while this one waited for the locks
+    if (atomic_load(&daemon->journaled) >= JOURNAL_COMPACT_THRESHOLD) {
+        pthread_rwlock_rdlock(&daemon->lock);
+        saveBookings(daemon->bookings);
+        pthread_rwlock_unlock(&daemon->lock);
+        atomic_store(&daemon->journaled, 0); // A failed rewrite is tried again after as many more records
+    }
+    for (int i = 0; i < DAEMON_ROOM_LOCKS; i++) {
+        pthread_mutex_unlock(&daemon->roomLocks[i]);
     }
-
-    // Close the file
-    fclose(file);
 }
 
 
-// Function to load events from a file
-void loadEvents(LoginLogoutEvent events[], int *eventCount) {
-    // Open the event file in read mode
-    FILE *file = fopen(EVENTS_FILE, "r");
-    if (file == NULL) {
-        printf("Error opening events file for reading.\n");
-        *eventCount = 0;
-        return; // No event file found, start with empty event list
-    }
+// Function to check whether the calendars must roll to a new day, a Reserved booking missed its check-in or a hold expired
+// Only reads the store, so workers call it under the read lock and take the write lock only when it is true
+bool needsBookingMaintenance(BookingStore *store) {
+    char currentDate[DATE_LENGTH];
+    getCurrentDate(currentDate, DATE_LENGTH);
+    int today = dateToDayNumber(currentDate);
+    const KeyedHeap *heap = &store->checkInDeadlines;
+    const KeyedHeap *holds = &store->holds;
+    return store->calendarStart != today || (heap->count > 0 && ((const CheckInDeadline*)heap->items)->checkIn < today) ||
+           (holds->count > 0 && ((const RoomHold*)holds->items)->expires <= (long long)time(NULL));
+}
 
-    *eventCount = 0; // Initialize event count
-    // Read event data from the file
-    while (fscanf(file, "%d, %25[^,], %6[^,], %25[^\n]\n", 
-                  &events[*eventCount].orderNum, 
-                  events[*eventCount].userId, 
-                  events[*eventCount].eventType, 
-                  events[*eventCount].timestamp) == 4) {
-        (*eventCount)++;
-    }
 
-    fclose(file);
+// Function to find the lock shard of a room
+pthread_mutex_t* roomLock(HotelDaemon *daemon, int roomId) {
+    return &daemon->roomLocks[hashRoomId(roomId) & (DAEMON_ROOM_LOCKS - 1)];
 }
 
 
-// Function to log an event 
-void logEvent(LoginLogoutEvent events[], int *eventCount, const char *userId, const char *eventType) {
-    if (*eventCount >= MAX_EVENTS) {
-        printf("Event log is full. Cannot log more events.\n");
-        return;
-    }
+// Function to hold a room for a terminal whose customer is deciding, and write the reply with the hold ID
+void daemonHoldRoom(HotelDaemon *daemon, int roomId, int checkIn, int checkOut, FILE *reply) {
+    pthread_mutex_t *lock = roomLock(daemon, roomId);
+    pthread_mutex_lock(lock);
 
-    // Log the event
-    events[*eventCount].orderNum = *eventCount + 1; // Assign a unique order number
-    strncpy(events[*eventCount].userId, userId, ID_LENGTH); // Copy user ID
-    strncpy(events[*eventCount].eventType, eventType, EVENT_TYPE_LENGTH); // Copy event type
-    getCurrentTimestamp(events[*eventCount].timestamp, DATE_TIME_LENGTH); // Get current time 
-    (*eventCount)++; // Increment event count
+    RoomHold hold;
+    pthread_rwlock_wrlock(&daemon->lock);
+    BookingResult result = placeHold(daemon->bookings, roomId, checkIn, checkOut, &hold);
+    pthread_rwlock_unlock(&daemon->lock);
 
-    // Save all events to the file
-    saveEvents(events, *eventCount);
+    pthread_mutex_unlock(lock);
+
+    fprintf(reply, "%d\n", result);
+    if (result == BOOKING_DONE) {
+        fprintf(reply, "%lld\n", hold.id);
+    }
 }
 
 
-// Function to search for events by User ID
-void searchEventsByUserId(LoginLogoutEvent events[], int eventCount) {
-    if (eventCount == 0) {
-        printf("No events available.\n");
-        return;
+// Function to reserve a room on behalf of a terminal and write the reply
+// Only reservations and holds add a stay to a room, and they hold the room's lock until they are done, so the
+// room cannot be taken between the check under the read lock and the insert; reservations of rooms in other
+// shards check and journal in parallel and only take the write lock for the insert itself.
+// A holdId other than 0 is the customer's own hold on the room, released first so it does not block the booking
+void daemonReserveRoom(HotelDaemon *daemon, const char *userId, int roomId, int checkIn, int checkOut, long long holdId, FILE *reply) {
+    BookingStore *store = daemon->bookings;
+    pthread_mutex_t *lock = roomLock(daemon, roomId);
+    pthread_mutex_lock(lock);
+
+    if (holdId < 0) {
+        RoomHold hold = { holdId, roomId, checkIn, checkOut, 0 };
+        pthread_rwlock_wrlock(&daemon->lock);
+        releaseHold(store, &hold);
+        pthread_rwlock_unlock(&daemon->lock);
     }
 
-    // Get User ID from the user
-    char userId[ID_LENGTH];
-    printf("Enter User ID to search: ");
-    fgets(userId, ID_LENGTH, stdin);
-    userId[strcspn(userId, "\n")] = '\0'; // Remove newline character
+    pthread_rwlock_rdlock(&daemon->lock);
+    BookingResult result = checkRoomFree(store, roomId, checkIn, checkOut);
+    pthread_rwlock_unlock(&daemon->lock);
 
-    // Display events for the specified User ID
-    printf("Event History for User ID '%s':\n", userId);
-    printf("===========================================\n");
-    for (int i = 0; i < eventCount; i++) {
-        if (strcmp(events[i].userId, userId) == 0) {
-            printf("Order Number: %d\n", events[i].orderNum);
-            printf("User ID: %s\n", events[i].userId);
-            printf("Event Type: %s\n", events[i].eventType);
-            printf("Timestamp: %s\n", events[i].timestamp);
-            printf("-------------------------------------------\n");
+    Booking booking;
+    if (result == BOOKING_DONE) {
+        pthread_rwlock_wrlock(&daemon->lock);
+        result = insertReservation(store, userId, roomId, checkIn, checkOut, &booking);
+        pthread_rwlock_unlock(&daemon->lock);
+    }
+
+    // The journal record and the reply read the customer ID from the store, which needs the read lock; the
+    // append itself happens without it, so waiting for an fsync never holds up the rest of the store
+    fprintf(reply, "%d\n", result);
+    if (result == BOOKING_DONE) {
+        size_t length;
+        pthread_rwlock_rdlock(&daemon->lock);
+        char *record = formatNewBookingRecord(store, &booking, &length);
+        writeBookingRecord(reply, store, &booking);
+        pthread_rwlock_unlock(&daemon->lock);
+
+        if (record != NULL && !appendToFile(store->disk, BOOKINGS_JOURNAL_FILE, record, length)) {
+            perror("Error: Unable to write bookings journal");
         }
+        free(record);
+        atomic_fetch_add(&daemon->journaled, 1);
     }
+
+    pthread_mutex_unlock(lock);
 }
 
 
-// Function to search for events within a specified date range
-void searchEventsByDateRange(LoginLogoutEvent events[], int eventCount) {
-    if (eventCount == 0) {
-        printf("No events available.\n");
-        return;
+// Function to cancel, check in or check out a booking on behalf of a terminal
+// The room's lock keeps the journal records of one booking in the order the changes were made
+BookingResult daemonChangeBooking(HotelDaemon *daemon, const char *userId, long long bookingId, BookingStatus status) {
+    BookingStore *store = daemon->bookings;
+
+    // Find the booking's room to know which lock to take; a booking never changes rooms
+    pthread_rwlock_rdlock(&daemon->lock);
+    Booking *booking = findBookingById(store, bookingId);
+    int roomId = booking != NULL ? booking->roomId : 0;
+    pthread_rwlock_unlock(&daemon->lock);
+    if (booking == NULL) {
+        return BOOKING_NOT_FOUND;
     }
 
-    // Get start and end dates from the user
-    char startDate[DATE_LENGTH], endDate[DATE_LENGTH];
-    // Prompt user to enter start date and validate
-    getValidDate(startDate, "Enter start date (YYYY-MM-DD): ", 1, NULL); // allowPastDate is set to 1 (true)
+    pthread_mutex_t *lock = roomLock(daemon, roomId);
+    pthread_mutex_lock(lock);
 
-    // Prompt user to enter end date and validate, ensuring it's later than start date
-    do {
-        getValidDate(endDate, "Enter end date (YYYY-MM-DD): ", 1, NULL); // allowPastDate is set to 1 (true)
+    pthread_rwlock_wrlock(&daemon->lock);
+    BookingResult result = applyBookingChange(store, userId, bookingId, status);
+    pthread_rwlock_unlock(&daemon->lock);
 
-        // Check if end date is later than start date
-        if (strcmp(startDate, endDate) >= 0) {
-            printf("End date must be later than start date. Please enter again.\n");
-        }
-    } while (strcmp(startDate, endDate) >= 0);
+    if (result == BOOKING_DONE) {
+        journalUpdateStatus(store, bookingId, status); // Record the change in the journal
+        atomic_fetch_add(&daemon->journaled, 1);
+    }
 
-    // Display events within the specified date range
-    printf("Event History within Date Range (%s - %s):\n", startDate, endDate);
-    printf("===========================================\n");
-    for (int i = 0; i < eventCount; i++) {
-        // Check if event timestamp falls within the specified range
-        if (strcmp(events[i].timestamp, startDate) >= 0 && strcmp(events[i].timestamp, endDate) <= 0) {
-            printf("Order Number: %d\n", events[i].orderNum);
-            printf("User ID: %s\n", events[i].userId);
-            printf("Event Type: %s\n", events[i].eventType);
-            printf("Timestamp: %s\n", events[i].timestamp);
-            printf("-------------------------------------------\n");
+    pthread_mutex_unlock(lock);
+    return result;
+}
+
+
+// Function to carry out one request against the booking store and write the reply
+// The reply is the BookingResult on the first line, then any booking records or room IDs, one per line
+void handleDaemonRequest(HotelDaemon *daemon, char **fields, int fieldCount, FILE *reply) {
+    BookingStore *store = daemon->bookings;
+    int roomId, field, checkIn, checkOut;
+    long long bookingId, holdId;
+    bool validUser = fieldCount > 1 && !isEmpty(fields[1]) && strlen(fields[1]) < ID_LENGTH;
+
+    char currentDate[DATE_LENGTH];
+    getCurrentDate(currentDate, DATE_LENGTH);
+    int today = dateToDayNumber(currentDate);
+
+    if (strcmp(fields[0], "CHECK") == 0 && fieldCount == 4 && parseIntField(fields[1], &roomId) &&
+        parseDateField(fields[2], &checkIn) && parseDateField(fields[3], &checkOut)) {
+        // CHECK, roomId, checkInDate, checkOutDate
+        pthread_rwlock_rdlock(&daemon->lock);
+        fprintf(reply, "%d\n", checkRoomFree(store, roomId, checkIn, checkOut));
+        pthread_rwlock_unlock(&daemon->lock);
+    } else if (strcmp(fields[0], "HOLD") == 0 && fieldCount == 4 && parseIntField(fields[1], &roomId) &&
+               parseDateField(fields[2], &checkIn) && parseDateField(fields[3], &checkOut) && checkIn >= today && checkIn < checkOut) {
+        // HOLD, roomId, checkInDate, checkOutDate
+        daemonHoldRoom(daemon, roomId, checkIn, checkOut, reply);
+    } else if (strcmp(fields[0], "RELEASE") == 0 && fieldCount == 3 && parseIntField(fields[1], &roomId) &&
+               parseLongLongField(fields[2], &holdId) && holdId < 0) {
+        // RELEASE, roomId, holdId
+        RoomHold hold = { holdId, roomId, 0, 0, 0 };
+        pthread_rwlock_wrlock(&daemon->lock);
+        releaseHold(store, &hold);
+        pthread_rwlock_unlock(&daemon->lock);
+        fprintf(reply, "%d\n", BOOKING_DONE);
+    } else if (strcmp(fields[0], "RESERVE") == 0 && (fieldCount == 5 || fieldCount == 6) && validUser && parseIntField(fields[2], &roomId) &&
+               parseDateField(fields[3], &checkIn) && parseDateField(fields[4], &checkOut) && checkIn >= today && checkIn < checkOut &&
+               (fieldCount == 5 || (parseLongLongField(fields[5], &holdId) && holdId < 0))) {
+        // RESERVE, userId, roomId, checkInDate, checkOutDate[, holdId]
+        daemonReserveRoom(daemon, fields[1], roomId, checkIn, checkOut, fieldCount == 6 ? holdId : 0, reply);
+    } else if (strcmp(fields[0], "CANCEL") == 0 && fieldCount == 3 && validUser && parseLongLongField(fields[2], &bookingId)) {
+        // CANCEL, userId, bookingId
+        fprintf(reply, "%d\n", daemonChangeBooking(daemon, fields[1], bookingId, CANCELLED));
+    } else if (strcmp(fields[0], "CHECKIN") == 0 && fieldCount == 3 && validUser && parseLongLongField(fields[2], &bookingId)) {
+        // CHECKIN, userId, bookingId
+        fprintf(reply, "%d\n", daemonChangeBooking(daemon, fields[1], bookingId, CHECKED_IN));
+    } else if (strcmp(fields[0], "CHECKOUT") == 0 && fieldCount == 3 && validUser && parseLongLongField(fields[2], &bookingId)) {
+        // CHECKOUT, userId, bookingId
+        fprintf(reply, "%d\n", daemonChangeBooking(daemon, fields[1], bookingId, CHECKED_OUT));
+    } else if (strcmp(fields[0], "FIND") == 0 && fieldCount == 4 && parseIntField(fields[1], &field) && field >= 1 && field <= 3 &&
+               parseDateField(fields[2], &checkIn) && parseDateField(fields[3], &checkOut)) {
+        // FIND, dateField (1 booking, 2 check-in, 3 check-out), startDate, endDate
+        // The date indexes are built by the first search, which changes the store
+        pthread_rwlock_rdlock(&daemon->lock);
+        while (!store->dateIndexesBuilt) {
+            pthread_rwlock_unlock(&daemon->lock);
+            pthread_rwlock_wrlock(&daemon->lock);
+            bool built = store->dateIndexesBuilt || buildDateIndexes(store);
+            pthread_rwlock_unlock(&daemon->lock);
+            if (!built) {
+                fprintf(reply, "%d\n", BOOKING_FAILED);
+                return;
+            }
+            pthread_rwlock_rdlock(&daemon->lock);
+        }
+        fprintf(reply, "%d\n", BOOKING_DONE);
+        const DateIndex *index = &store->dateIndexes[field - 1];
+        for (int i = findDateIndexPosition(index, checkIn); i < index->count && index->keys[i].day <= checkOut; i++) {
+            writeBookingRecord(reply, store, getBooking(store, index->keys[i].handle));
+        }
+        pthread_rwlock_unlock(&daemon->lock);
+    } else if ((strcmp(fields[0], "CURRENT") == 0 || strcmp(fields[0], "HISTORY") == 0) && fieldCount == 2 && validUser) {
+        // CURRENT, userId or HISTORY, userId
+        fprintf(reply, "%d\n", BOOKING_DONE);
+        pthread_rwlock_rdlock(&daemon->lock);
+        writeUserBookings(store, fields[1], strcmp(fields[0], "CURRENT") == 0, reply);
+        pthread_rwlock_unlock(&daemon->lock);
+    } else if (strcmp(fields[0], "HELD") == 0 && fieldCount == 3 && parseDateField(fields[1], &checkIn) && parseDateField(fields[2], &checkOut)) {
+        // HELD, startDate, endDate
+        pthread_rwlock_rdlock(&daemon->lock);
+        int *heldRooms = malloc((store->roomStayCount + 1) * sizeof(int));
+        int heldCount = heldRooms != NULL ? collectHeldRooms(store, checkIn, checkOut, heldRooms) : 0;
+        pthread_rwlock_unlock(&daemon->lock);
+        if (heldRooms == NULL) {
+            fprintf(reply, "%d\n", BOOKING_FAILED);
+            return;
         }
+        fprintf(reply, "%d\n", BOOKING_DONE);
+        for (int i = 0; i < heldCount; i++) {
+            fprintf(reply, "%d\n", heldRooms[i]);
+        }
+        free(heldRooms);
+    } else {
+        fprintf(reply, "%d\n", BOOKING_BAD_REQUEST);
     }
 }
 
 
-// Function to manage events
-void manageEvents(LoginLogoutEvent events[], int eventCount) {
-    int choice = 0;
-    while (choice != 3) {
-        printf("\n========== MANAGE EVENTS =========\n");
-        printf("1. Search for events by User ID\n");
-        printf("2. Search for events by specificied duration\n");
-        printf("3. Exit\n");
-        printf("=================================\n");
-        printf("Enter your choice: ");
-        scanf("%d", &choice);
-        getchar(); // Consume the newline character left in the input buffer
-        
-        switch (choice) {
-            case 1: 
-                searchEventsByUserId(events, eventCount);
-                break;
-            case 2: 
-                searchEventsByDateRange(events, eventCount);
-                break;
-            case 3: 
-                printf("Exiting... Thank you!\n"); 
-                break;
-            default: 
-                printf("Invalid choice. Please try again.\n");
+// Function to write a customer's current (Reserved or Checked-In) or past (Cancelled or Checked-Out) bookings
+void writeUserBookings(BookingStore *store, const char *userId, bool current, FILE *reply) {
+    // Only walk this customer's own bookings
+    int userHandle = findInternedString(&store->userIds, userId);
+    int bookingCount = userHandle >= 0 && userHandle < store->userBookingCapacity ? store->userBookings[userHandle].count : 0;
+    for (int i = 0; i < bookingCount; i++) {
+        Booking *booking = getBooking(store, store->userBookings[userHandle].handles[i]);
+        bool isCurrent = booking->status == RESERVED || booking->status == CHECKED_IN;
+        if (isCurrent == current) {
+            writeBookingRecord(reply, store, booking);
         }
     }
 }
 
 
 // Function to display administrator menu
-void adminMenu(User users[], int *userCount, Room rooms[], int *roomCount, LoginLogoutEvent events[], int *eventCount, const char *userId) {
+void adminMenu(UserStore *users, RoomStore *rooms, EventStore *events, const char *userId) {
     int choice = 0;
     while (choice != 4) {
         printf("\n======= ADMINISTRATOR MENU =======\n");
@@ -2026,11 +5999,11 @@ void adminMenu(User users[], int *userCount, Room rooms[], int *roomCount, Login
         getchar(); // Consume the newline character left in the input buffer
         
         switch (choice) {
-        case 1: manageUsers(users, userCount); break;
-        case 2: manageRooms(rooms, *roomCount); break;
-        case 3: manageEvents(events, *eventCount); break;
+        case 1: manageUsers(users); break;
+        case 2: manageRooms(rooms); break;
+        case 3: manageEvents(events); break;
         case 4: printf("Logging out... Thank you!\n"); 
-                logEvent(events, eventCount, userId, "Logout");
+                logEvent(events, userId, "Logout");
                 break;
         default: printf("Invalid choice. Please try again.\n");
         }
@@ -2054,12 +6027,16 @@ void displayStaffMenuOptions() {
 
 
 // Function to display hotel staff menu
-void hotelStaffMenu(User users[], int *userCount, Room rooms[], int *roomCount, Booking **head, int *bookingCount, LoginLogoutEvent events[], int *eventCount, const char *userId) {
+// With remote set every booking operation is sent to the daemon
+void hotelStaffMenu(UserStore *users, RoomStore *rooms, BookingStore *bookings, EventStore *events, bool remote, const char *userId) {
     int choice = 0;
     char customerUserID[ID_LENGTH];; char* result;
     int roomId;
 
     do {
+        if (!remote) {
+            autoCancelReservations(bookings); // Keep cancelling missed check-ins during long sessions
+        }
         displayStaffMenuOptions(); // Extracted the menu display into a separate function
         printf("Enter your choice: "); 
         scanf("%d", &choice); 
@@ -2067,32 +6044,32 @@ void hotelStaffMenu(User users[], int *userCount, Room rooms[], int *roomCount,
 
         switch (choice) {
             case 1: {
-                result = checkUserStatus(users, userCount);
+                result = checkUserStatus(users);
                 if (result != NULL) {
                     strcpy(customerUserID, result);
                     free(result); // Free the dynamically allocated memory
                     // Proceed with further operations using userId
-                    makeReservation(head, bookingCount, rooms, roomCount, customerUserID);
+                    makeReservation(bookings, rooms, remote, customerUserID);
                 } 
                 break;
             }
             
             case 2: 
-                result = checkUserStatus(users, userCount);
+                result = checkUserStatus(users);
                 if (result != NULL) {
                     strcpy(customerUserID, result);
                     free(result); // Free the dynamically allocated memory
-                    cancelReservation(head, bookingCount, customerUserID);
+                    cancelReservation(bookings, remote, customerUserID);
                 }
                 break;
-            case 3: checkin(*head, *bookingCount); break;
-            case 4: checkout(*head, *bookingCount); break;
-            case 5: viewBookingHistory(*head, *bookingCount); break;
-            case 6: checkRoomAvailabilities(head, rooms, roomCount); break;
-            case 7: searchRooms(rooms, roomCount); break;
+            case 3: checkin(bookings, remote); break;
+            case 4: checkout(bookings, remote); break;
+            case 5: viewBookingHistory(bookings, remote); break;
+            case 6: checkRoomAvailabilities(bookings, rooms, remote); break;
+            case 7: searchRooms(rooms); break;
             case 8: 
                 printf("Logging out... Thank you!\n"); 
-                logEvent(events, eventCount, userId, "Logout");
+                logEvent(events, userId, "Logout");
                 break;
             default: 
                 printf("Invalid choice. Please try again.\n");
@@ -2116,26 +6093,30 @@ void displayCustomerMenuOptions() {
 
 
 // Function to display customer menu
-void hotelCustomerMenu(Room rooms[], int *roomCount, Booking **head, int *bookingCount, LoginLogoutEvent events[], int *eventCount, const char *userId) {
+// With remote set every booking operation is sent to the daemon
+void hotelCustomerMenu(RoomStore *rooms, BookingStore *bookings, EventStore *events, bool remote, const char *userId) {
     int choice = 0;
     int roomId;
 
     do {
+        if (!remote) {
+            autoCancelReservations(bookings); // Keep cancelling missed check-ins during long sessions
+        }
         displayCustomerMenuOptions(); // Extracted the menu display into a separate function
         printf("Enter your choice: "); 
         scanf("%d", &choice); 
         getchar(); // Consume newline character
 
         switch (choice) {
-            case 1: makeReservation(head, bookingCount, rooms, roomCount, userId); break;
-            case 2: cancelReservation(head, bookingCount, userId); break;
-            case 3: checkBookingHistory(*head, *bookingCount, userId); break;
-            case 4: checkCurrentBooking(*head, *bookingCount, userId); break;
-            case 5: checkRoomAvailabilities(head, rooms, roomCount); break;
-            case 6: searchRooms(rooms, roomCount); break;
+            case 1: makeReservation(bookings, rooms, remote, userId); break;
+            case 2: cancelReservation(bookings, remote, userId); break;
+            case 3: checkBookingHistory(bookings, remote, userId); break;
+            case 4: checkCurrentBooking(bookings, remote, userId); break;
+            case 5: checkRoomAvailabilities(bookings, rooms, remote); break;
+            case 6: searchRooms(rooms); break;
             case 7: 
                 printf("Logging out... Thank you!\n"); 
-                logEvent(events, eventCount, userId, "Logout");
+                logEvent(events, userId, "Logout");
                 break;
             default: 
                 printf("Invalid choice. Please try again.\n");
@@ -2156,26 +6137,25 @@ void displayMainMenu() {
 
 
 // Function to authenticate a user
-int authenticateUser(User users[], int *userCount, const char *input_id, const char *input_password) {
+int authenticateUser(UserStore *users, const char *input_id, const char *input_password) {
     // Load user data if not already loaded
-    if (*userCount == 0) {
-        if (!loadUsers(users, userCount)) {
+    if (users->count == 0) {
+        if (!loadUsers(users)) {
             printf("Error: Unable to load user data.\n");
             return -1;
         }
     }
 
-    for (int i = 0; i < *userCount; i++) {
-        if (strcmp(users[i].id, input_id) == 0 && strcmp(users[i].password, input_password) == 0) {
-            return i; // User authenticated successfully   
-        }
+    int i = findUserIndex(users, input_id);
+    if (i != -1 && strcmp(users->items[i].password, input_password) == 0) {
+        return i; // User authenticated successfully
     }
     return -1; // User not found or password incorrect
 }
 
 
 // Function to login
-void loginUser(User users[], int *userCount, Room rooms[], int *roomCount, Booking **head, int *bookingCount, LoginLogoutEvent events[], int *eventCount) {
+void loginUser(UserStore *users, RoomStore *rooms, BookingStore *bookings, EventStore *events, bool remote) {
     char input_id[ID_LENGTH], input_password[PASSWORD_LENGTH];
     int orderNum;
 
@@ -2189,20 +6169,24 @@ void loginUser(User users[], int *userCount, Room rooms[], int *roomCount, Booki
     input_password[strcspn(input_password, "\n")] = '\0'; // Remove newline character
 
     // Authenticate user
-    orderNum = authenticateUser(users, userCount, input_id, input_password);
+    orderNum = authenticateUser(users, input_id, input_password);
     if (orderNum >= 0) {
-        if (users[orderNum].active == 1) {
-            printf("\nLogged in successful. Welcome, %s!\n", users[orderNum].name);
+        if (users->items[orderNum].active == 1) {
+            printf("\nLogged in successful. Welcome, %s!\n", users->items[orderNum].name);
             // Log the login event
-            logEvent(events, eventCount, users[orderNum].id, "Login");
+            logEvent(events, users->items[orderNum].id, "Login");
+
+            // The menus get their own copy of the ID, since registering or reloading users moves the users array
+            char userId[ID_LENGTH];
+            strcpy(userId, users->items[orderNum].id);
 
             // Display menu based on role
-            if (strcmp(users[orderNum].role, "Administrator") == 0) {
-                adminMenu(users, userCount, rooms, roomCount, events, eventCount, users[orderNum].id);
-            } else if (strcmp(users[orderNum].role, "Hotel Staff") == 0) {
-                hotelStaffMenu(users, userCount, rooms, roomCount, head, bookingCount, events, eventCount, users[orderNum].id);
+            if (strcmp(users->items[orderNum].role, "Administrator") == 0) {
+                adminMenu(users, rooms, events, userId);
+            } else if (strcmp(users->items[orderNum].role, "Hotel Staff") == 0) {
+                hotelStaffMenu(users, rooms, bookings, events, remote, userId);
             } else {
-                hotelCustomerMenu(rooms, roomCount, head, bookingCount, events, eventCount, users[orderNum].id);
+                hotelCustomerMenu(rooms, bookings, events, remote, userId);
             }
         } else {
             printf("User ID '%s' is inactive. Please contact the administrator.\n", input_id);
@@ -8,50 +8,215 @@
 #include <ctype.h>     // Functions for character classification
 #include <time.h>      // Functions for manipulating date and time
 #include <regex.h>     // POSIX regular expression library
+#include <fcntl.h>     // File control options for open
+#include <unistd.h>    // POSIX I/O functions
+#include <sys/file.h>  // Advisory file locking with flock
+#include <sys/stat.h>  // File sizes for bulk reads
+#include <sys/mman.h>  // Memory-mapped snapshot loading
+#include <float.h>     // FLT_MAX for open-ended room filters
+#include <stdarg.h>    // Variable arguments for formatted daemon requests
+#include <signal.h>    // Shutdown signals of the daemon
+#include <poll.h>      // Waiting on the daemon socket and its wake-up pipe
+#include <pthread.h>   // Worker threads of the daemon and the event writer thread
+#include <stdatomic.h> // Lock-free event queue
+#include <sys/socket.h> // Unix domain sockets between the daemon and its terminals
+#include <sys/un.h>    // Unix domain socket addresses
+#include <errno.h>     // Telling a missing file apart from a failed sync
+#include <stddef.h>    // offsetof for the keys of heap entries
 
 
 #define NAME_LENGTH 26 // Maximum length of a name
 #define ID_LENGTH 26 // Maximum length of a id
 #define PASSWORD_LENGTH 26 // Maximum length of a password
 #define ROLE_LENGTH 26 // Maximum length of a role
-#define MAX_USERS 100 // Maximum number of users that can be stored
-#define MAX_ROOMS 50 // Maximum number of rooms that can be stored
+#define MIN_ROOM_ID 101 // Smallest valid room ID
+#define MAX_ROOM_ID 999999 // Largest valid room ID
 #define BEDTYPE_LENGTH 26 // Maximum length of a bedtype
 #define MAX_AMENITIES 3 // Maximum amenities of a room
-#define AMENITY_LENGTH 26 // Maximum amenities of a room
-#define AMENITIES_LENGTH 100 // Maximum length of amenities description
-#define MAX_BOOKINGS 200 // Maximum number of bookings that can be stored
+#define MAX_AMENITY_NAMES 64 // Different amenities across all rooms, one bit each in an amenity set
+#define AMENITY_LENGTH 26 // Maximum length of an amenity name
+#define AMENITIES_LENGTH 100 // Maximum length of a '|' separated amenity list in the rooms file
 #define STATUS_LENGTH 26 // Maximum length of a booking status
 #define DATE_LENGTH 11 // Maximum length of a date
-#define MAX_EVENTS 500 // Maximum number of login/logout events
 #define EVENT_TYPE_LENGTH 7 // Maximum length of an event type ("login" or "logout")
 #define DATE_TIME_LENGTH 26 // Maximum length of a timestamp
+#define DATE_TIME_TEXT_LENGTH 19 // Length of a YYYY-MM-DD HH:MM:SS timestamp
+#define EVENT_FLUSH_INTERVAL 1 // Seconds the event writer sleeps between appends of the queued events
+#define BOOKING_ID_BLOCK_SIZE 64 // Booking IDs reserved by a terminal at a time
+#define RESERVATION_HOLD_SECONDS 60 // How long a room stays held for a customer deciding whether to reserve it
+#define BOOKING_CHUNK_SIZE 4096 // Bookings per arena chunk
+#define JOURNAL_COMPACT_THRESHOLD 1000 // Journal records replayed at startup before the snapshot is rewritten
+#define JOURNAL_STATUS_RECORD_LENGTH 48 // Longest "S, id, status" journal line, including the newline
+#define CALENDAR_WORDS 12 // 64-night words in each room's occupancy calendar
+#define ROOM_FILTER_BLOCK 1024 // Rooms filtered per kernel call; room catalog columns are a multiple of this long
+#define CALENDAR_DAYS (CALENDAR_WORDS * 64) // Nights covered by the calendar horizon (about two years)
+#define DAEMON_WORKER_COUNT 8 // Threads of the daemon that serve requests
+#define DAEMON_QUEUE_LENGTH 256 // Accepted connections that may wait for a free worker
+#define DAEMON_REQUEST_LENGTH 256 // Longest request line a terminal may send
+#define DAEMON_TIMEOUT 5 // Seconds the daemon and its terminals wait for the other side before giving up
+#define DAEMON_FIELDS 6 // Most fields in a request line, including the operation
+#define DAEMON_ROOM_LOCKS 64 // Room lock shards of the daemon, a power of two
+#define ASYNC_COMMIT_INTERVAL_MS 100 // Async mode: how often the committer writes and syncs the buffered appends
+#define APPEND_FILE_COUNT 4 // Files only ever appended to: the three journals and the events file
 
 
 // File paths for storing data
 #define USERS_FILE "users.txt"
+#define USERS_JOURNAL_FILE "users_journal.txt"
 #define ROOMS_FILE "rooms.txt"
+#define ROOMS_JOURNAL_FILE "rooms_journal.txt"
 #define BOOKINGS_FILE "bookings.txt"
+#define BOOKINGS_JOURNAL_FILE "bookings_journal.txt"
+#define BOOKING_IDS_FILE "booking_ids.txt"
 #define EVENTS_FILE "login_logout_events.txt"
+#define SNAPSHOT_FILE "hotel_snapshot.bin"
+#define SNAPSHOT_TEMP_FILE "hotel_snapshot.bin.tmp"
+#define USERS_TEMP_FILE "users.txt.tmp"
+#define ROOMS_TEMP_FILE "rooms.txt.tmp"
+#define BOOKINGS_TEMP_FILE "bookings.txt.tmp"
+#define DAEMON_SOCKET_FILE "hotel.sock"
+#define DAEMON_LOCK_FILE "hotel.lock"
+
+// Binary snapshot format
+#define SNAPSHOT_MAGIC "HOTELSNP" // First eight bytes of a snapshot file
+#define SNAPSHOT_VERSION 4 // Bump whenever a stored record layout changes
+#define SNAPSHOT_FILE_COUNT 7 // Text files stamped in the snapshot header
+
+// Number of comma-separated fields in each data file record
+#define USER_FIELDS 6
+#define STANDARD_ROOM_FIELDS 7
+#define SUITE_ROOM_FIELDS 8
+#define BOOKING_FIELDS 8
+#define EVENT_FIELDS 4
+#define MIN_BOOKING_LINE 64 // Typical length of a bookings.txt line, used to size the ID index on load
 
 
 // Define structures
 typedef struct {
-    int orderNum;
+    const char *path; // File being parsed, for error messages
+    char *data; // Whole file contents, tokenized in place
+    size_t size; // Number of bytes in data
+    char *cursor; // Start of the next unread line
+    int lineNumber; // Line number of the last record returned
+} RecordReader;
+
+typedef unsigned int (*SlotHash)(const void *owner, int entry); // Hash of the key of an entry of a SlotIndex
+typedef bool (*SlotMatch)(const void *owner, int entry, const void *key); // Whether an entry of a SlotIndex has a key
+
+typedef struct {
+    int *slots; // Open-addressing hash table of entries (positions or handles owned by a store), -1 marks an empty slot
+    int capacity; // Number of slots, always a power of two
+    int count; // Number of entries in the table
+    bool mapped; // True while slots point into the snapshot mapping; they are never freed
+} SlotIndex;
+
+typedef struct {
+    char **strings; // Interned strings, indexed by handle
+    int count; // Number of interned strings
+    int capacity; // Allocated length of strings
+    SlotIndex index; // Hash index from string to handle
+} StringPool;
+
+typedef struct {
+    int *handles; // Handles (booking handles or event positions) in the order they were added
+    int count; // Number of handles
+    int capacity; // Allocated length of handles
+} HandleList;
+
+// How hard the save paths work to get a change onto the disk, chosen with --durability
+typedef enum {
+    DURABILITY_NONE, // Write each change at once and leave it to the operating system to reach the disk
+    DURABILITY_ASYNC, // Buffer appends in memory; the committer writes and syncs them every ASYNC_COMMIT_INTERVAL_MS
+    DURABILITY_FSYNC // Write each change at once and return only once it is synced; appends made during one fsync share the next
+} DurabilityMode;
+
+// A journal or the events file as seen by the committer
+typedef struct {
+    const char *path; // NULL while the entry is unused
+    char *buffer; // Async mode: appends not yet written
+    size_t length; // Bytes in buffer
+    size_t capacity; // Allocated length of buffer
+    bool dirty; // Fsync mode: written since it was last synced
+} AppendFile;
+
+// Persistence layer shared by every store. A full rewrite goes to a temporary file that is renamed over the
+// old one, so a crash leaves either the old or the new file; appends are written, buffered or group-committed
+// according to mode by a single committer thread
+typedef struct {
+    DurabilityMode mode;
+    AppendFile files[APPEND_FILE_COUNT];
+    long long appended; // Fsync mode: appends made so far
+    long long committed; // Fsync mode: appends known to be on disk
+    pthread_mutex_t lock; // Guards files, appended, committed and stopping
+    pthread_mutex_t writeLock; // Held while the committer takes and writes a batch and while a rewrite replaces a journal; taken before lock
+    pthread_cond_t wake; // Signalled when an append waits for an fsync or the committer must stop
+    pthread_cond_t done; // Broadcast after every commit
+    pthread_t thread;
+    bool running; // True while the committer runs; without it every append is written (and synced) by its caller
+    bool stopping; // Set to make the committer commit what is left and exit
+} Persistence;
+
+// The order number of a user or room is its rank among the live records when the file is written
+typedef struct {
     char name[NAME_LENGTH];
     char id[ID_LENGTH];
     char password[PASSWORD_LENGTH];
     char role[ROLE_LENGTH];
     int active; // 1 if active, 0 if inactive
+    bool deleted; // True for the slot of a deleted user, kept until a new user reuses it
 } User;
 
+typedef struct {
+    User *items; // User slots; a user keeps its slot until it is deleted
+    int count; // Number of slots in use, including those of deleted users
+    int capacity; // Allocated length of items
+    bool itemsMapped; // True while items point into the snapshot mapping; they are copied out before they grow
+    SlotIndex idIndex; // Hash index from user ID to position
+    int *freeSlots; // Positions of deleted users, reused before items grows
+    int freeCount; // Number of free positions
+    int freeCapacity; // Allocated length of freeSlots
+    Persistence *disk; // Where changes are saved
+} UserStore;
+
 typedef struct {
     int orderNum;
     char userId[ID_LENGTH];
     char eventType[EVENT_TYPE_LENGTH]; // "login" or "logout"
-    char timestamp[DATE_TIME_LENGTH];  // Format: YYYY-MM-DD HH:MM:SS
+    long long timestamp; // Local time in seconds since 1970-01-01 00:00:00, written as YYYY-MM-DD HH:MM:SS
 } LoginLogoutEvent;
 
+// An event waiting in the event writer's queue
+typedef struct EventNode {
+    LoginLogoutEvent event;
+    struct EventNode *_Atomic next; // The next newer event, NULL until a producer links one
+} EventNode;
+
+// Background appender of logged events: a lock-free multi-producer, single-consumer queue drained by one thread.
+// A producer swaps its node into head and then links the old head to it, so logging never takes a lock or
+// touches the disk; only the writer thread walks from tail and appends each batch to the events file in one write
+typedef struct {
+    EventNode *_Atomic head; // Newest node, NULL until the writer is started
+    EventNode *tail; // Node before the oldest queued event, its own event is already written; writer thread only
+    atomic_bool stopping; // Set to make the writer thread write what is left and exit
+    pthread_mutex_t wakeLock; // Guards the writer's sleep; producers never take it
+    pthread_cond_t wake; // Signalled when the writer must stop
+    pthread_t thread;
+    bool running; // True while the writer thread runs; without it events are written as they are logged
+    Persistence *disk; // Where the events are appended
+} EventWriter;
+
+typedef struct {
+    LoginLogoutEvent *items; // Events in the order they were logged
+    int count; // Number of events
+    int capacity; // Allocated length of items
+    bool itemsMapped; // True while items point into the snapshot mapping; they are copied out before they grow
+    EventWriter writer; // Appends logged events to the events file in the background
+    bool inTimeOrder; // True while every event is no earlier than the one before it, so items can be binary searched by time
+    StringPool userIds; // Interned user IDs of the events
+    HandleList *userEvents; // Positions in items of each user's events, indexed by user handle
+    int userEventCapacity; // Allocated length of userEvents
+} EventStore;
+
 typedef enum {
     STANDARD, // This is assigned the value 0
     SUITE     // This is assigned the value 1
@@ -65,31 +230,261 @@ typedef union {
     struct {
         char bedType[BEDTYPE_LENGTH]; // Single or Double
         float size; // Size of the room in square meters
-        char amenities[AMENITIES_LENGTH]; // Amenities available in the suite
+        unsigned long long amenities; // Amenities available in the suite, bit (1 << n) for amenity n of the room store's dictionary
     } suite;
 } RoomDetails;
 
 typedef struct {
-    int orderNum;
     int id;
     RoomType type; // Enum to indicate whether it's Standard or Suite
     RoomDetails details; // Union representing different details of rooms
     float rate;
     int active; // 1 if active, 0 if inactive
+    bool deleted; // True for the slot of a deleted room, kept until a new room reuses it
 } Room;
 
-typedef struct Booking {
-    int orderNum;
-    int id; // A unique identifier for the booking
-    char userId[ID_LENGTH]; // Customer ID whose books rooms
+typedef enum {
+    SINGLE_BED,
+    DOUBLE_BED,
+    OTHER_BED // Any bed type name other than "Single" or "Double"
+} BedType;
+
+// Struct-of-arrays copy of the room fields that searches filter on, indexed by room position,
+// so a filter streams through a few dense columns instead of whole Room records
+typedef struct {
+    unsigned char *types; // RoomType of each room
+    unsigned char *bedTypes; // BedType of each room
+    float *rates; // Rate of each room in RM
+    float *sizes; // Size of each room in square meters
+    unsigned long long *amenities; // Amenity set of each room, 0 for standard rooms
+    unsigned char *active; // 1 if the room is active and not deleted, 0 otherwise
+    int capacity; // Allocated length of each column
+} RoomCatalog;
+
+// Conditions an active room must all meet to match a search
+typedef struct {
+    int type; // RoomType to match, or -1 for any
+    int bedType; // BedType to match, or -1 for any
+    float minRate, maxRate; // Inclusive rate range
+    float minSize, maxSize; // Inclusive size range
+    unsigned long long allAmenities; // Amenities a room must all have, 0 for no condition
+    unsigned long long anyAmenities; // Amenities a room must have at least one of, 0 for no condition
+} RoomFilter;
+
+typedef struct {
+    Room *items; // Room slots; a room keeps its slot until it is deleted
+    int count; // Number of slots in use, including those of deleted rooms
+    int capacity; // Allocated length of items
+    bool itemsMapped; // True while items point into the snapshot mapping; they are copied out before they grow
+    SlotIndex idIndex; // Hash index from room ID to position
+    int *freeSlots; // Positions of deleted rooms, reused before items grows
+    int freeCount; // Number of free positions
+    int freeCapacity; // Allocated length of freeSlots
+    RoomCatalog catalog; // Column copy of the searchable fields of every slot
+    StringPool amenityNames; // Amenity dictionary; the handle of a name is its bit in amenity sets
+    Persistence *disk; // Where changes are saved
+} RoomStore;
+
+typedef enum {
+    RESERVED,    // "Reserved"
+    CHECKED_IN,  // "Checked-In"
+    CHECKED_OUT, // "Checked-Out"
+    CANCELLED,   // "Cancelled"
+    INVALID_STATUS // Not a status; what parseBookingStatus returns for any other text
+} BookingStatus;
+
+// Dates are day numbers (days since 1970-01-01) and are only converted to YYYY-MM-DD text
+// when loading, saving or displaying; the order number of a booking is its position in the store
+typedef struct {
+    long long id; // A unique identifier for the booking
     int roomId;
-    char status[STATUS_LENGTH]; // "Reserved", "Checked-In", "Checked-Out", "Cancelled"
-    char bookingDate[DATE_LENGTH]; // Assuming date format YYYY-MM-DD (including null terminator)
-    char checkInDate[DATE_LENGTH]; // Assuming date format YYYY-MM-DD (including null terminator)
-    char checkOutDate[DATE_LENGTH]; // Assuming date format YYYY-MM-DD (including null terminator)
-    struct Booking *next; // Pointer to next node in the list
+    int userHandle; // Customer ID whose books rooms, interned in BookingStore.userIds
+    int bookingDate; // Day number of the booking date
+    int checkInDate; // Day number of the check-in date
+    int checkOutDate; // Day number of the check-out date
+    unsigned char status; // BookingStatus of the booking
 } Booking;
 
+typedef struct {
+    int checkIn; // Check-in date as a day number
+    int checkOut; // Check-out date as a day number
+    long long bookingId; // Booking that holds the room for this stay, or the negative ID of a tentative hold
+} Stay;
+
+typedef struct {
+    int roomId;
+    Stay *stays; // Reserved and Checked-In stays and tentative holds of the room, sorted by check-in day
+    int *maxCheckOut; // maxCheckOut[i] is the latest check-out among stays[0..i]
+    int count; // Number of stays
+    int capacity; // Allocated length of stays and maxCheckOut
+    unsigned long long occupied[CALENDAR_WORDS]; // Bit n is set when night calendarStart + n is held by a stay
+} RoomStays;
+
+typedef enum {
+    BOOKING_DATE_FIELD, // Booking.bookingDate
+    CHECK_IN_DATE_FIELD, // Booking.checkInDate
+    CHECK_OUT_DATE_FIELD, // Booking.checkOutDate
+    BOOKING_DATE_FIELD_COUNT
+} BookingDateField;
+
+typedef struct {
+    int day; // Day number of the indexed date
+    int handle; // Booking with that date
+} DateKey;
+
+typedef struct {
+    DateKey *keys; // Bookings sorted by day, then by handle
+    int count; // Number of keys
+    int capacity; // Allocated length of keys
+} DateIndex;
+
+typedef struct {
+    void *items; // Binary min-heap of fixed-size entries, ordered by a long long key inside each entry
+    int count; // Number of entries
+    int capacity; // Allocated length of items, in entries
+} KeyedHeap;
+
+typedef struct {
+    long long checkIn; // Check-in day number of the booking, the heap key
+    int handle; // Reserved booking that is cancelled if not checked in by then
+} CheckInDeadline;
+
+// A room held for a customer between the availability check and the reservation, so nobody else can take it
+// meanwhile; the hold is a stay of the room until it is released, turned into a booking, or expires
+typedef struct {
+    long long id; // Negative, so it never matches a booking ID in the stay index
+    int roomId;
+    int checkIn; // Check-in date as a day number
+    int checkOut; // Check-out date as a day number
+    long long expires; // Time (seconds since the epoch) at which the hold lapses, the heap key
+} RoomHold;
+
+typedef struct {
+    long long next; // Next ID to hand out
+    long long end; // First ID past the block reserved by this terminal
+} BookingIdBlock;
+
+typedef struct {
+    Booking **chunks; // Arena of BOOKING_CHUNK_SIZE bookings per chunk; chunks never move, so handles stay valid
+    int chunkCapacity; // Allocated length of chunks
+    int mappedChunks; // Leading chunks that point into the snapshot mapping instead of their own memory
+    int count; // Number of bookings, the handle of a booking is its position in the arena
+    SlotIndex idIndex; // Hash index from booking ID to handle
+    StringPool userIds; // Interned customer IDs referenced by bookings
+    HandleList *userBookings; // Bookings of each customer, indexed by user handle
+    int userBookingCapacity; // Allocated length of userBookings
+    DateIndex dateIndexes[BOOKING_DATE_FIELD_COUNT]; // Bookings ordered by each of their dates
+    bool dateIndexesBuilt; // Set once the date indexes are built; later bookings are inserted in place
+    long long maxId; // Largest booking ID in the store
+    BookingIdBlock idBlock; // Booking IDs reserved for this terminal
+    RoomStays *roomStays; // Per-room stay index, sorted by room ID
+    int roomStayCount; // Number of rooms in the stay index
+    int roomStayCapacity; // Allocated length of roomStays
+    int calendarStart; // Day number of the first night in the room calendars
+    bool staysIncomplete; // Set when a stay could not be indexed; rooms could then look free when they are not, so reservations are refused
+    KeyedHeap checkInDeadlines; // CheckInDeadline entries by check-in day; entries for bookings no longer Reserved are skipped when popped
+    KeyedHeap holds; // RoomHold entries by expiry time; entries of holds already released are skipped when popped, and holds are never saved
+    long long lastHoldId; // ID of the last hold placed, counting down from -1
+    Persistence *disk; // Where changes are saved
+} BookingStore;
+
+// Outcome of a booking operation, also sent as the first line of every daemon reply
+typedef enum {
+    BOOKING_DONE, // The operation succeeded
+    BOOKING_NOT_FOUND, // No booking has the given ID
+    BOOKING_WRONG_USER, // The booking belongs to another customer
+    BOOKING_WRONG_STATUS, // The booking's status does not allow the operation
+    BOOKING_ALREADY_CHECKED_IN, // Check-in of a booking that is already Checked-In
+    BOOKING_WRONG_DATE, // Check-in on a day other than the booking's check-in date
+    BOOKING_ROOM_TAKEN, // Another stay holds the room on some of the requested nights
+    BOOKING_NO_ID, // No booking ID could be reserved
+    BOOKING_FAILED, // The booking could not be stored
+    BOOKING_BAD_REQUEST, // The daemon could not parse the request
+    BOOKING_UNREACHABLE // The daemon could not be reached; only returned on the terminal side
+} BookingResult;
+
+// Lock on DAEMON_LOCK_FILE held for the life of the process; every terminal also appends one byte to the
+// file when it starts, so the file only keeps its length while no other terminal starts
+typedef struct {
+    int fd; // Open lock file, -1 if this process holds no lock
+    bool aloneAtStart; // True if no daemon or other terminal was running when this one started
+    long long joinMark; // Length of the lock file right after this process announced itself
+} DirectoryLock;
+
+// Shared state of the daemon: one acceptor thread queues connections and the worker threads
+// answer one request per connection against the booking store loaded at startup.
+// A worker that changes a booking first takes the lock of the booking's room shard, then the store lock;
+// never the other way round
+typedef struct {
+    BookingStore *bookings; // Booking state shared by every terminal
+    pthread_rwlock_t lock; // Read-held while a worker looks at the bookings, write-held while it changes them
+    pthread_mutex_t roomLocks[DAEMON_ROOM_LOCKS]; // Held from the check of a room to the journal write of its change
+    atomic_int journaled; // Bookings journal records appended since the bookings file was last rewritten
+    int listenFd; // Listening socket at DAEMON_SOCKET_FILE
+    int wakePipe[2]; // Written on shutdown to wake the acceptor out of poll
+    int queue[DAEMON_QUEUE_LENGTH]; // Ring buffer of accepted connections waiting for a worker
+    int queueHead; // Position of the oldest waiting connection
+    int queueCount; // Number of waiting connections
+    pthread_mutex_t queueLock; // Guards the queue and stopping
+    pthread_cond_t queueReady; // Signalled when a connection is queued or the daemon stops
+    pthread_cond_t queueSpace; // Signalled when a worker takes a connection from a full queue
+    bool stopping; // Set once a shutdown signal arrived
+    pthread_t acceptor;
+    pthread_t workers[DAEMON_WORKER_COUNT];
+} HotelDaemon;
+
+typedef enum {
+    SNAPSHOT_USERS, // User records
+    SNAPSHOT_ROOMS, // Room records
+    SNAPSHOT_AMENITY_NAMES, // Amenity names in bit order, AMENITY_LENGTH bytes each
+    SNAPSHOT_BOOKINGS, // Booking records in handle order
+    SNAPSHOT_BOOKING_USER_IDS, // Customer IDs of bookings in handle order, ID_LENGTH bytes each
+    SNAPSHOT_BOOKING_ID_SLOTS, // Slots of the booking ID index
+    SNAPSHOT_EVENTS, // Login and logout event records
+    SNAPSHOT_SECTION_COUNT
+} SnapshotSectionId;
+
+typedef struct {
+    long long size; // File size in bytes, -1 if the file did not exist
+    long long mtime; // Last modification time
+    long long inode; // Inode number, changes when the file is replaced by a rename
+    unsigned long long contentHash; // Hash of the contents, only set when hashed is 1
+    int hashed; // 1 if the file was modified in the same second the snapshot was written
+    int reserved; // Padding, always zero
+} FileStamp;
+
+typedef struct {
+    long long offset; // Byte offset of the first record from the start of the snapshot
+    long long count; // Number of records
+    int recordSize; // Size of one record, checked against the structures of this build
+    int reserved; // Padding, always zero
+} SnapshotSection;
+
+// The snapshot is this header followed by the sections it points to, each 8-byte aligned.
+// Records are stored exactly as laid out in memory, so a snapshot is only valid for builds with the same layout.
+typedef struct {
+    char magic[8]; // SNAPSHOT_MAGIC without its terminator
+    int version; // SNAPSHOT_VERSION of the writer
+    int headerSize; // sizeof(SnapshotHeader) of the writer
+    long long writtenAt; // When the stamps were taken
+    long long maxBookingId; // Largest booking ID in the snapshot
+    FileStamp stamps[SNAPSHOT_FILE_COUNT]; // Users, rooms and bookings files and their journals, and the events file it was built from
+    SnapshotSection sections[SNAPSHOT_SECTION_COUNT];
+} SnapshotHeader;
+
+// The snapshot file mapped for the life of the process; the fixed-size records of the stores are used in place
+// and only copied when a page is first written (the mapping is private) or an array has to grow
+typedef struct {
+    char *base; // Start of the mapping, NULL if the stores were not loaded from a snapshot
+    size_t size; // Length of the mapping
+} SnapshotMapping;
+
+// The text data files as they were just before the stores were loaded, from them or from a snapshot of them
+typedef struct {
+    long long stampedAt; // When the stamps were taken
+    FileStamp files[SNAPSHOT_FILE_COUNT];
+} DataFileStamps;
+
 
 // FUNCTION PROTOTYPE
 
@@ -101,92 +496,280 @@ bool containComma(const char *str); // 3
 bool isEmpty(const char *str);
 void clearInputBuffer();
 void getCurrentDate(char* buffer, int bufferSize);
+int dateToDayNumber(const char *date);
+bool isValidDate(const char *date);
+void dayNumberToDate(int dayNumber, char *buffer, int bufferSize);
+unsigned int hashString(const char *str);
+void placeSlotEntry(int *slots, int capacity, int entry, unsigned int hash);
+bool reserveSlotIndex(SlotIndex *index, int expected, SlotHash hash, const void *owner);
+bool addSlotEntry(SlotIndex *index, int entry, SlotHash hash, const void *owner);
+void removeSlotEntry(SlotIndex *index, int entry, SlotHash hash, const void *owner);
+int findSlotEntry(const SlotIndex *index, unsigned int keyHash, SlotMatch matches, const void *owner, const void *key);
+void clearSlotIndex(SlotIndex *index);
+unsigned int hashInternedEntry(const void *pool, int handle);
+bool matchInternedEntry(const void *pool, int handle, const void *str);
+int findInternedString(StringPool *pool, const char *str);
+int internString(StringPool *pool, const char *str);
+const char* internedString(StringPool *pool, int handle);
+void freeStringPool(StringPool *pool);
 void getValidDate(char* date, const char* prompt, int allowPastDate, const char* referenceDate);
-void getCurrentTimestamp(char *buffer, int bufferSize);
+long long getCurrentTimestamp();
+long long parseTimestamp(const char *text);
+void formatTimestamp(long long timestamp, char *buffer, int bufferSize);
+bool openRecordReader(RecordReader *reader, const char *path);
+int nextRecord(RecordReader *reader, char **fields, int maxFields);
+void reportMalformedRecord(RecordReader *reader, const char *reason);
+void closeRecordReader(RecordReader *reader);
+bool parseIntField(const char *field, int *value);
+bool parseLongLongField(const char *field, long long *value);
+bool parseFloatField(const char *field, float *value);
+bool parseDateField(const char *field, int *day);
+bool copyField(char *dest, const char *field, size_t size);
+void openRecordBuffer(RecordReader *reader, const char *path, char *data, size_t size);
+bool writeAll(int fd, const char *data, size_t size);
+bool growArray(void **items, int count, int *capacity, size_t itemSize);
+bool growMappedArray(void **items, int count, int *capacity, size_t itemSize, bool *mapped);
+long long keyedHeapKey(const KeyedHeap *heap, int position, size_t entrySize, size_t keyOffset);
+bool pushKeyedHeap(KeyedHeap *heap, const void *entry, size_t entrySize, size_t keyOffset);
+void popKeyedHeap(KeyedHeap *heap, size_t entrySize, size_t keyOffset);
+bool appendToHandleList(HandleList **lists, int *listCapacity, int key, int handle);
 
 
 // User Functions
 
-void saveUsers(User users[], int userCount);
-int loadUsers(User users[], int *userCount);
-void addAdministratorInfoToFile(User users[], int *userCount);
+void saveUsers(UserStore *users);
+int loadUsers(UserStore *users);
+void indexUsers(UserStore *users);
+unsigned int hashUserEntry(const void *users, int position);
+bool matchUserEntry(const void *users, int position, const void *id);
+bool indexUser(UserStore *users, int position);
+int findUserIndex(UserStore *users, const char *id);
+void unindexUser(UserStore *users, int position);
+int allocateUserSlot(UserStore *users);
+void returnUserSlot(UserStore *users, int position);
+bool releaseUserSlot(UserStore *users, int position);
+void journalDeleteUser(UserStore *users, const char *id);
+int replayUserJournal(UserStore *users);
+void addAdministratorInfoToFile(UserStore *users);
 char* promptValidName();
-char* promptValidID(User users[], int userCount);
+char* promptValidID(UserStore *users);
 char* promptValidPassword();
 char* promptValidRole();
-void registerUser(User users[], int *userCount);
-void updateUserPassword(User users[], int *userCount);
-void updateUserStatus(User users[], int *userCount);
-void deleteUser(User users[], int *userCount);
-void displayUser(User users[], int *userCount);
-char* checkUserStatus(User users[], int *userCount);
+void registerUser(UserStore *users);
+void updateUserPassword(UserStore *users);
+void updateUserStatus(UserStore *users);
+void deleteUser(UserStore *users);
+void displayUser(UserStore *users);
+char* checkUserStatus(UserStore *users);
 void displayMenuManageUsers();
-void manageUsers(User users[], int *userCount);
+void manageUsers(UserStore *users);
 
 
 // Room Functions
 
-void saveRooms(Room rooms[], int roomCount);
-void loadRooms(Room rooms[], int *roomCount);
-int promptValidRoomID(Room rooms[], int roomCount);
+void saveRooms(RoomStore *rooms);
+void loadRooms(RoomStore *rooms);
+unsigned int hashRoomId(int id);
+void indexRooms(RoomStore *rooms);
+unsigned int hashRoomEntry(const void *rooms, int position);
+bool matchRoomEntry(const void *rooms, int position, const void *roomId);
+bool indexRoom(RoomStore *rooms, int position);
+int findRoomIndex(RoomStore *rooms, int roomId);
+void unindexRoom(RoomStore *rooms, int position);
+int allocateRoomSlot(RoomStore *rooms);
+void returnRoomSlot(RoomStore *rooms, int position);
+bool releaseRoomSlot(RoomStore *rooms, int position);
+void journalDeleteRoom(RoomStore *rooms, int roomId);
+int replayRoomJournal(RoomStore *rooms);
+BedType bedTypeCode(const char *bedType);
+bool reserveRoomCatalog(RoomCatalog *catalog, int capacity);
+void catalogRoom(RoomStore *rooms, int position);
+void buildRoomCatalog(RoomStore *rooms);
+void freeRoomCatalog(RoomCatalog *catalog);
+void initRoomFilter(RoomFilter *filter);
+void maskRoomsEqual(unsigned char *restrict mask, const unsigned char *restrict column, unsigned char value);
+void maskRoomsInRange(unsigned char *restrict mask, const float *restrict column, float min, float max);
+void maskRoomsWithAll(unsigned char *restrict mask, const unsigned long long *restrict column, unsigned long long amenities);
+void maskRoomsWithAny(unsigned char *restrict mask, const unsigned long long *restrict column, unsigned long long amenities);
+int roomSearchLength(RoomStore *rooms);
+int filterRooms(RoomStore *rooms, const RoomFilter *filter, int *positions);
+int displayMatchingRooms(RoomStore *rooms, const RoomFilter *filter);
+int promptValidRoomID(RoomStore *rooms);
 float promptValidRoomSize();
 float promptValidRoomRate();
 char* promptValidRoomBedType();
 int promptValidRoomType();
-char* promptValidAmenities();
-void addRoom(Room rooms[], int *roomCount);
-void deleteRoom(Room rooms[], int *roomCount);
-void updateRoomStatus(Room rooms[], int *roomCount);
-void displayRoom(Room rooms[], int *roomCount, int roomId);
-void searchByRoomType(Room rooms[], int *roomCount);
-void searchByBedType(Room rooms[], int *roomCount);
-void searchByRate(Room rooms[], int *roomCount);
-void searchRooms(Room rooms[], int *roomCount);
-int checkRoomStatus(Room rooms[], int *roomCount);
+unsigned long long promptValidAmenities(RoomStore *rooms);
+int internAmenity(RoomStore *rooms, const char *name);
+bool parseAmenities(RoomStore *rooms, const char *names, unsigned long long *amenities);
+void formatAmenities(RoomStore *rooms, unsigned long long amenities, char *buffer, int bufferSize);
+void addRoom(RoomStore *rooms);
+void deleteRoom(RoomStore *rooms);
+void updateRoomStatus(RoomStore *rooms);
+void displayRoom(RoomStore *rooms, int roomId);
+void searchByRoomType(RoomStore *rooms);
+void searchByBedType(RoomStore *rooms);
+void searchByRate(RoomStore *rooms);
+void searchByFilters(RoomStore *rooms);
+void searchByAmenities(RoomStore *rooms);
+void searchRooms(RoomStore *rooms);
+int checkRoomStatus(RoomStore *rooms);
 void displayMenuManageRooms();
-void manageRooms(Room rooms[], int roomCount);
+void manageRooms(RoomStore *rooms);
 
 
 // Booking Functions
 
-void saveBookings(Booking *head);
-Booking* loadBookings(int *bookingCount);
-int generateUniqueId(Booking* head);
-void addBookingNode(Booking **head, int *bookingCount, int uniqueId, const char *userId, int roomId, const char *bookingDate, const char *checkInDate, const char *checkOutDate);
-int isRoomAvailableForBooking(Booking *head, int roomId, const char *checkInDate, const char *checkOutDate);
-void displayBookingIdDetails(int *id, const char *userId, int *roomId, char *status, char *bookingDate, char *checkInDate, char *checkOutDate);
-void makeReservation(Booking **head, int *bookingCount, Room rooms[], int *roomCount, const char *userId);
-void cancelReservation(Booking **head, int *bookingCount, const char *userId);
-void autoCancelReservations(Booking **head);
-void freeBookings(Booking *head);
-void checkin(Booking *head, int bookingCount);
-void checkout(Booking *head, int bookingCount);
-void updateOrderNumbers(Booking *head);
-void viewBookingHistory(Booking *head, int bookingCount);
-void checkCurrentBooking(Booking *head, int bookingCount, const char* userId);
-void checkBookingHistory(Booking *head, int bookingCount, const char* userId);
-void checkRoomAvailabilities(Booking **head, Room rooms[], int *roomCount);
+void saveBookings(BookingStore *store);
+void loadBookings(BookingStore *store);
+char* formatNewBookingRecord(BookingStore *store, const Booking *booking, size_t *length);
+void journalAddBooking(BookingStore *store, const Booking *booking);
+void journalUpdateStatus(BookingStore *store, long long id, BookingStatus status);
+void journalStatusChanges(BookingStore *store, const long long *ids, int count, BookingStatus status);
+int replayBookingJournal(BookingStore *store);
+bool parseBookingFields(BookingStore *store, char **fields, Booking *record);
+void indexRoomStays(BookingStore *store);
+long long generateUniqueId(BookingStore *store);
+int reserveBookingIdBlock(BookingStore *store);
+Booking* findBookingById(BookingStore *store, long long id);
+unsigned int hashBookingId(long long id);
+unsigned int hashBookingEntry(const void *store, int handle);
+bool matchBookingEntry(const void *store, int handle, const void *id);
+void indexBookingId(BookingStore *store, int handle);
+void indexUserBooking(BookingStore *store, int handle);
+int bookingDateOf(const Booking *booking, BookingDateField field);
+int compareDateKeys(const void *a, const void *b);
+bool buildDateIndexes(BookingStore *store);
+void insertDateIndexes(BookingStore *store, int handle);
+int findDateIndexPosition(const DateIndex *index, int day);
+Booking* getBooking(BookingStore *store, int handle);
+Booking* appendBooking(BookingStore *store, const Booking *booking);
+Booking makeBookingRecord(BookingStore *store, long long id, const char *userId, int roomId, const char *status, const char *bookingDate, const char *checkInDate, const char *checkOutDate);
+const char* bookingStatusName(BookingStatus status);
+BookingStatus parseBookingStatus(const char *status);
+Booking* addBookingNode(BookingStore *store, long long uniqueId, const char *userId, int roomId, const char *bookingDate, const char *checkInDate, const char *checkOutDate);
+int isRoomAvailableForBooking(BookingStore *store, int roomId, int checkIn, int checkOut);
+int collectHeldRooms(BookingStore *store, int checkIn, int checkOut, int *heldRooms);
+bool isCalendarRangeFree(const RoomStays *roomStays, int from, int to);
+void markCalendarNights(RoomStays *roomStays, int calendarStart, int checkIn, int checkOut, bool held);
+void rollRoomCalendars(BookingStore *store);
+RoomStays* findRoomStays(BookingStore *store, int roomId, bool create);
+void updateMaxCheckOut(RoomStays *roomStays, int from);
+bool addRoomStay(BookingStore *store, const Booking *booking);
+void removeRoomStay(BookingStore *store, const Booking *booking);
+RoomStays* reserveRoomStay(BookingStore *store, int roomId);
+bool insertRoomStay(BookingStore *store, int roomId, Stay stay);
+void deleteRoomStay(BookingStore *store, int roomId, long long bookingId);
+BookingResult placeHold(BookingStore *store, int roomId, int checkIn, int checkOut, RoomHold *hold);
+void releaseHold(BookingStore *store, const RoomHold *hold);
+void expireHolds(BookingStore *store);
+void pushHold(BookingStore *store, const RoomHold *hold);
+void popHold(BookingStore *store);
+void applyBookingStatus(BookingStore *store, Booking *booking, BookingStatus status);
+void displayBookingIdDetails(BookingStore *store, const Booking *booking);
+void writeBookingRecord(FILE *file, BookingStore *store, const Booking *booking);
+bool readBookingRecord(BookingStore *store, RecordReader *reader, Booking *booking);
+int displayBookingRecords(BookingStore *store, RecordReader *reader);
+BookingResult checkRoomFree(BookingStore *store, int roomId, int checkIn, int checkOut);
+BookingResult insertReservation(BookingStore *store, const char *userId, int roomId, int checkIn, int checkOut, Booking *booking);
+BookingResult reserveRoom(BookingStore *store, const char *userId, int roomId, int checkIn, int checkOut, Booking *booking);
+BookingResult applyBookingChange(BookingStore *store, const char *userId, long long bookingId, BookingStatus status);
+BookingResult changeBooking(BookingStore *store, const char *userId, long long bookingId, BookingStatus status);
+void makeReservation(BookingStore *store, RoomStore *rooms, bool remote, const char *userId);
+void cancelReservation(BookingStore *store, bool remote, const char *userId);
+void autoCancelReservations(BookingStore *store);
+int takeOverdueReservations(BookingStore *store, long long **cancelledIds);
+void pushCheckInDeadline(BookingStore *store, int handle);
+void popCheckInDeadline(BookingStore *store);
+void freeBookings(BookingStore *store);
+void checkin(BookingStore *store, bool remote);
+void checkout(BookingStore *store, bool remote);
+void viewBookingHistory(BookingStore *store, bool remote);
+void checkCurrentBooking(BookingStore *store, bool remote, const char* userId);
+void checkBookingHistory(BookingStore *store, bool remote, const char* userId);
+void checkRoomAvailabilities(BookingStore *store, RoomStore *rooms, bool remote);
+bool containsRoomId(const int *roomIds, int count, int roomId);
 
 
 // Login Logout Event Functions
 
-void saveEvents(LoginLogoutEvent events[], int eventCount);
-void loadEvents(LoginLogoutEvent events[], int *eventCount);
-void logEvent(LoginLogoutEvent events[], int *eventCount, const char *userId, const char *eventType);
-void searchEventsByUserId(LoginLogoutEvent events[], int eventCount);
-void searchEventsByDateRange(LoginLogoutEvent events[], int eventCount);
-void manageEvents(LoginLogoutEvent events[], int eventCount);
+void loadEvents(EventStore *events);
+void logEvent(EventStore *events, const char *userId, const char *eventType);
+bool startEventWriter(EventWriter *writer, Persistence *disk);
+void stopEventWriter(EventWriter *writer);
+bool pushEvent(EventWriter *writer, const LoginLogoutEvent *event);
+void writeQueuedEvents(EventWriter *writer);
+void* runEventWriter(void *arg);
+void indexEvent(EventStore *events, int position);
+int findFirstEventAt(EventStore *events, long long timestamp);
+void displayEvent(const LoginLogoutEvent *event);
+void freeEvents(EventStore *events);
+void searchEventsByUserId(EventStore *events);
+void searchEventsByDateRange(EventStore *events);
+void manageEvents(EventStore *events);
+
+
+// Persistence Functions
+
+bool parseDurabilityMode(const char *name, DurabilityMode *mode);
+void startPersistence(Persistence *disk, DurabilityMode mode);
+void stopPersistence(Persistence *disk);
+bool appendToFile(Persistence *disk, const char *path, const char *data, size_t length);
+AppendFile* findAppendFile(Persistence *disk, const char *path);
+bool writeToFile(const char *path, const char *data, size_t length);
+bool syncFile(const char *path);
+bool replaceFile(Persistence *disk, FILE *file, const char *tempPath, const char *path, const char *journalPath);
+void commitAppends(Persistence *disk);
+void* runCommitter(void *arg);
+
+
+// Snapshot Functions
+
+void stampDataFiles(FileStamp *stamps, long long writtenAt);
+bool hashFileContents(const char *path, unsigned long long *hash);
+void stampLoadedFiles(DataFileStamps *loaded);
+bool sameFileStamps(const FileStamp *saved, const FileStamp *current);
+bool isSnapshotCurrent(const SnapshotHeader *header);
+bool writeSnapshotSection(FILE *file, SnapshotHeader *header, SnapshotSectionId id, const void *records, long long count, int recordSize);
+void saveSnapshot(UserStore *users, RoomStore *rooms, BookingStore *bookings, EventStore *events, const DataFileStamps *loaded);
+const void* snapshotSection(const char *base, size_t size, const SnapshotHeader *header, SnapshotSectionId id, int recordSize);
+bool loadSnapshot(UserStore *users, RoomStore *rooms, BookingStore *bookings, EventStore *events, DataFileStamps *loaded, SnapshotMapping *mapping);
+
+
+// Daemon Functions
+
+int connectToDaemon();
+bool isDaemonRunning();
+bool lockHotelDirectory(DirectoryLock *lock, bool exclusive);
+void announceTerminal(DirectoryLock *lock);
+bool ranAlone(DirectoryLock *lock);
+char* readSocket(int fd, size_t maxSize, size_t *size);
+BookingResult daemonRequest(RecordReader *reply, const char *format, ...);
+int openDaemonSocket();
+void runDaemon(BookingStore *bookings);
+void* acceptDaemonConnections(void *arg);
+void* serveDaemonConnections(void *arg);
+void serveDaemonConnection(HotelDaemon *daemon, int fd);
+bool needsBookingMaintenance(BookingStore *store);
+void compactBookingJournal(HotelDaemon *daemon);
+void journalOverdueCancellations(HotelDaemon *daemon, const bool *shards, const long long *cancelledIds, int cancelledCount);
+pthread_mutex_t* roomLock(HotelDaemon *daemon, int roomId);
+void daemonHoldRoom(HotelDaemon *daemon, int roomId, int checkIn, int checkOut, FILE *reply);
+void daemonReserveRoom(HotelDaemon *daemon, const char *userId, int roomId, int checkIn, int checkOut, long long holdId, FILE *reply);
+BookingResult daemonChangeBooking(HotelDaemon *daemon, const char *userId, long long bookingId, BookingStatus status);
+void handleDaemonRequest(HotelDaemon *daemon, char **fields, int fieldCount, FILE *reply);
+void writeUserBookings(BookingStore *store, const char *userId, bool current, FILE *reply);
 
 
 // Menu Functions
 
-void adminMenu(User users[], int *userCount, Room rooms[], int *roomCount, LoginLogoutEvent events[], int *eventCount, const char *userId);
+void adminMenu(UserStore *users, RoomStore *rooms, EventStore *events, const char *userId);
 void displayStaffMenuOptions();
-void hotelStaffMenu(User users[], int *userCount, Room rooms[], int *roomCount, Booking **head, int *bookingCount, LoginLogoutEvent events[], int *eventCount, const char *userId);
+void hotelStaffMenu(UserStore *users, RoomStore *rooms, BookingStore *bookings, EventStore *events, bool remote, const char *userId);
 void displayCustomerMenuOptions();
-void hotelCustomerMenu(Room rooms[], int *roomCount, Booking **head, int *bookingCount, LoginLogoutEvent events[], int *eventCount, const char *userId);
+void hotelCustomerMenu(RoomStore *rooms, BookingStore *bookings, EventStore *events, bool remote, const char *userId);
 void displayMainMenu();
-int authenticateUser(User users[], int *userCount, const char *input_id, const char *input_password);
-void loginUser(User users[], int *userCount, Room rooms[], int *roomCount, Booking **head, int *bookingCount, LoginLogoutEvent events[], int *eventCount);
+int authenticateUser(UserStore *users, const char *input_id, const char *input_password);
+void loginUser(UserStore *users, RoomStore *rooms, BookingStore *bookings, EventStore *events, bool remote);
 
 #endif
\ No newline at end of file